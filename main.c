@@ -48,6 +48,7 @@
 #include <unistd.h>
 
 #include "pm_core.h"
+#include "pm_query.h"
 
 /**
  * Print the usage
@@ -61,6 +62,9 @@ void usage()
 	printf("  -d, --direct             Start without notification\n");
 	printf
 	    ("  -x, --xdpms              With LCD-onoff control by x-dpms \n");
+	printf
+	    ("  -q, --query <cmd>        Print stats, info, log, hal, blenv or uevent\n"
+	     "                           of the running daemon\n");
 	printf("\n");
 
 	exit(0);
@@ -83,10 +87,11 @@ int main(int argc, char *argv[])
 			{"foreground", no_argument, NULL, 'f'},
 			{"direct", no_argument, NULL, 'd'},
 			{"xdpms", no_argument, NULL, 'x'},
+			{"query", required_argument, NULL, 'q'},
 			{0, 0, 0, 0}
 		};
 
-		c = getopt_long(argc, argv, "fdx", long_options, &option_index);
+		c = getopt_long(argc, argv, "fdxq:", long_options, &option_index);
 		if (c == -1)
 			break;
 
@@ -103,6 +108,13 @@ int main(int argc, char *argv[])
 			flags = flags | FLAG_X_DPMS;	/* 0x2 : X control LCD onoff */
 			break;
 
+		case 'q':
+			if (pm_query(optarg, STDOUT_FILENO) < 0) {
+				printf("Query to the PM failed. Is it running?\n");
+				return -1;
+			}
+			return 0;
+
 		default:
 			usage();
 			break;
@@ -112,21 +124,21 @@ int main(int argc, char *argv[])
 	if (optind < argc)
 		usage();
 
-	if (access(DEFAULT_PID_PATH, F_OK) == 0) {	/* pid file exist */
+	if (access(runtime_path(DEFAULT_PID_PATH), F_OK) == 0) {	/* pid file exist */
 		printf
 		    ("Check the PM is running. If it isn't, delete \"%s\" and retry.\n",
-		     DEFAULT_PID_PATH);
+		     runtime_path(DEFAULT_PID_PATH));
 		return -1;
 	}
 
 	if (!runflags)
 		daemonize();
 
-	writepid(DEFAULT_PID_PATH);
+	writepid(runtime_path(DEFAULT_PID_PATH));
 
 	/* this function is main loop, defined in pm_core.c */
 	start_main(flags);
 
-	unlink(DEFAULT_PID_PATH);
+	unlink(runtime_path(DEFAULT_PID_PATH));
 	return 0;
 }
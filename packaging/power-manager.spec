@@ -1,3 +1,6 @@
+# pmctrl starts the daemon with -x, which uses pm_dpms_helper
+%bcond_without x
+
 Name:       power-manager
 Summary:    Power manager
 Version:    1.3.21
@@ -16,6 +19,10 @@ BuildRequires:  pkgconfig(sensor)
 BuildRequires:  pkgconfig(devman)
 BuildRequires:  pkgconfig(devman_plugin)
 BuildRequires:  pkgconfig(heynoti)
+%if %{with x}
+BuildRequires:  pkgconfig(x11)
+BuildRequires:  pkgconfig(xext)
+%endif
 
 %description
 Description: Power manager
@@ -29,10 +36,18 @@ Group:      TO_BE/FILLED_IN
 Description: Power manager
 
 
+%package devel
+Summary:    Power manager shared state page header
+Group:      TO_BE/FILLED_IN
+
+%description devel
+Description: Power manager shared state page header for the clients
+
+
 %prep
 %setup -q 
 
-cmake . -DCMAKE_INSTALL_PREFIX=%{_prefix}
+cmake . -DCMAKE_INSTALL_PREFIX=%{_prefix} %{?with_x:-DBUILD_DPMS_HELPER=ON}
 
 %build
 make %{?jobs:-j%jobs}
@@ -51,9 +66,9 @@ ln -s %{_sysconfdir}/init.d/power_manager.sh %{buildroot}%{_sysconfdir}/rc.d/rc5
 vconftool set -t int memory/pm/state 0 -i
 heynotitool set system_wakeup
 
-mkdir -p /etc/udev/rules.d
-if ! [ -L /etc/udev/rules.d/91-power-manager.rules ]; then
-        ln -s /usr/share/power-manager/udev-rules/91-power-manager.rules /etc/udev/rules.d/91-power-manager.rules
+# the hotplug is read from the kernel uevents now
+if [ -L /etc/udev/rules.d/91-power-manager.rules ]; then
+        rm -f /etc/udev/rules.d/91-power-manager.rules
 fi
 
 
@@ -63,8 +78,12 @@ fi
 /etc/rc.d/init.d/power_manager.sh
 /etc/rc.d/rc3.d/S35power-manager
 /etc/rc.d/rc5.d/S00power-manager
-/usr/bin/pm_event
+%if %{with x}
+/usr/bin/pm_dpms_helper
+%endif
 /usr/bin/pmctrl
 /usr/bin/power_manager
-/usr/share/power-manager/udev-rules/91-power-manager.rules
 
+%files devel
+%defattr(-,root,root,-)
+%{_includedir}/power-manager/pm_state.h
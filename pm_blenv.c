@@ -0,0 +1,213 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_blenv.c
+ * @version	0.1
+ * @brief	Brightness persistence in the bootloader environment
+ */
+
+#define _GNU_SOURCE
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "util.h"
+#include "pm_poll.h"
+#include "pm_blenv.h"
+
+#define SAVE_BLENV_PATH		"/usr/bin/save_blenv"
+#define SAVE_BLENV_KEY		"SLP_LCD_BRIGHT"
+
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open		434
+#endif
+
+extern char **environ;
+
+static guint debounce_id;
+static int pending_level = -1;	/* -1 : nothing to write */
+static int written_level = -1;
+
+static pid_t blenv_pid;		/* 0 : no save_blenv running */
+static int blenv_level;		/* level written by blenv_pid */
+static int blenv_pidfd = -1;
+static pm_watch *blenv_watch;
+
+static unsigned int requests;
+static unsigned int debounced;	/* replaced by a later level */
+static unsigned int unchanged;	/* same as the last written level */
+static unsigned int writes;
+static unsigned int failed;
+
+static void submit_pending(void);
+
+/* collect save_blenv, options : 0 to wait for it or WNOHANG */
+static void reap_write(int options)
+{
+	int ret, status;
+
+	while ((ret = waitpid(blenv_pid, &status, options)) < 0
+	       && errno == EINTR) ;
+	if (ret == 0)
+		return;
+
+	if (blenv_watch != NULL) {
+		pm_poll_del_fd(blenv_watch);
+		blenv_watch = NULL;
+	}
+	if (blenv_pidfd >= 0) {
+		close(blenv_pidfd);
+		blenv_pidfd = -1;
+	}
+	blenv_pid = 0;
+
+	if (ret < 0) {
+		LOGERR("save_blenv wait error : %s", strerror(errno));
+		failed++;
+	} else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		LOGERR("save_blenv %d failed, status %d", blenv_level, status);
+		failed++;
+	} else {
+		written_level = blenv_level;
+	}
+
+	/* a level which came while it was running */
+	if (debounce_id == 0)
+		submit_pending();
+}
+
+static gboolean blenv_exited(int fd, void *data)
+{
+	reap_write(WNOHANG);
+
+	return TRUE;
+}
+
+static void start_write(int level)
+{
+	char arg[16];
+	char *argv[4];
+	int ret;
+
+	snprintf(arg, sizeof(arg), "%d", level);
+	argv[0] = SAVE_BLENV_PATH;
+	argv[1] = SAVE_BLENV_KEY;
+	argv[2] = arg;
+	argv[3] = NULL;
+
+	ret = posix_spawn(&blenv_pid, argv[0], NULL, NULL, argv, environ);
+	if (ret != 0) {
+		LOGERR("cannot start %s : %s", argv[0], strerror(ret));
+		blenv_pid = 0;
+		failed++;
+		return;
+	}
+	blenv_level = level;
+
+	blenv_pidfd = syscall(__NR_pidfd_open, blenv_pid, 0);
+	if (blenv_pidfd >= 0) {
+		fcntl(blenv_pidfd, F_SETFD, FD_CLOEXEC);
+		blenv_watch = pm_poll_add_fd(blenv_pidfd, blenv_exited, NULL);
+	}
+	/* without an exit notification, wait for it like before */
+	if (blenv_watch == NULL)
+		reap_write(0);
+}
+
+static void submit_pending(void)
+{
+	int level = pending_level;
+
+	/* one save_blenv at a time, the level is kept until it exits */
+	if (blenv_pid != 0 || level < 0)
+		return;
+	pending_level = -1;
+
+	if (level == written_level) {
+		unchanged++;
+		return;
+	}
+	LOGINFO("Brightness set in bl : %d", level);
+	writes++;
+	start_write(level);
+}
+
+static gboolean debounce_expired(gpointer data)
+{
+	debounce_id = 0;
+	submit_pending();
+
+	return FALSE;
+}
+
+void pm_blenv_save_brt(int level)
+{
+	requests++;
+	if (pending_level >= 0)
+		debounced++;
+	if (debounce_id)
+		g_source_remove(debounce_id);
+	pending_level = level;
+	debounce_id = g_timeout_add(BLENV_DEBOUNCE, debounce_expired, NULL);
+}
+
+void pm_blenv_flush(void)
+{
+	if (debounce_id) {
+		g_source_remove(debounce_id);
+		debounce_id = 0;
+	}
+	while (blenv_pid != 0 || pending_level >= 0) {
+		if (blenv_pid != 0)
+			reap_write(0);
+		else
+			submit_pending();
+	}
+}
+
+void pm_blenv_print(int fd)
+{
+	char buf[256];
+	int len;
+
+	if (fd < 0)
+		return;
+
+	len = snprintf(buf, sizeof(buf),
+		       "requests %u, writes %u, failed %u, avoided %u "
+		       "(debounced %u, unchanged %u), last level %d%s%s\n",
+		       requests, writes, failed, debounced + unchanged,
+		       debounced, unchanged, written_level,
+		       pending_level >= 0 ? ", pending" : "",
+		       blenv_pid != 0 ? ", writing" : "");
+	write(fd, buf, len);
+}
+
+int exit_pm_blenv(void)
+{
+	pm_blenv_flush();
+
+	return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_blenv.h
+ * @version	0.1
+ * @brief	Brightness persistence in the bootloader environment
+ *
+ * The brightness is written by save_blenv once it has not changed for
+ * BLENV_DEBOUNCE ms, e.g. at the end of a slider drag, and only when it
+ * differs from the last written value. save_blenv runs next to the main
+ * loop, not on the display HAL worker, and the level counts as written
+ * only once it has exited with 0.
+ */
+#ifndef __PM_BLENV_H__
+#define __PM_BLENV_H__
+
+/**
+ * @addtogroup POWER_MANAGER
+ * @{
+ */
+
+#define BLENV_DEBOUNCE	1000	/* ms */
+
+/*
+ * save the brightness level, later
+ */
+extern void pm_blenv_save_brt(int level);
+
+/*
+ * write the pending level now and wait for it, e.g. before suspend
+ */
+extern void pm_blenv_flush(void);
+
+/*
+ * print the write counters
+ */
+extern void pm_blenv_print(int fd);
+
+extern int exit_pm_blenv(void);
+
+/**
+ * @}
+ */
+
+#endif				/*__PM_BLENV_H__ */
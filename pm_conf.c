@@ -33,6 +33,7 @@ static char *def_values[][IDX_END] = {
 	{"PM_TO_LCDDIM", "5"},
 	{"PM_TO_LCDOFF", "5"},
 	{"PM_TO_SLEEP", "0"},
+	{"PM_TO_SLACK", "200"},
 	{"PM_SYS_POWER", "/sys/power/state"},
 	{"PM_SYS_BRIGHT", "/sys/class/backlight/mobile-bl/brightness"},
 	{"PM_SYS_BRIGHT", "/sys/class/backlight/mobile-bl/max_brightness"},
@@ -40,6 +41,7 @@ static char *def_values[][IDX_END] = {
 	{"PM_SYS_DIMBRT", "0"},
 	{"PM_SYS_BLON", "0"},
 	{"PM_SYS_BLOFF", "4"},
+	{"PM_SYS_BLON_EARLY", "0"},
 	{"PM_SYS_FB_NORMAL", "1"},
 	{"PM_SYS_STATE", "mem"},
 	{"PM_EXEC_PRG", NULL},
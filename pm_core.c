@@ -28,6 +28,7 @@
 #include <unistd.h>
 #include <limits.h>
 #include <glib.h>
+#include <glib-unix.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
@@ -35,6 +36,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <sys/syscall.h>
 #include <heynoti.h>
 #include <sysman.h>
 #include <aul.h>
@@ -42,12 +44,17 @@
 
 #include "pm_device_plugin.h"
 #include "pm_core.h"
+#include "pm_shm.h"
+#include "pm_twheel.h"
+#include "pm_stats.h"
+#include "pm_hal.h"
+#include "pm_blenv.h"
+#include "pm_uevent.h"
+#include "pm_query.h"
 
 #define USB_CON_PIDFILE			"/var/run/.system_server.pid"
 #define PM_STATE_LOG_FILE		"/var/log/pm_state.log"
 #define PM_WAKEUP_NOTI_NAME		"system_wakeup"
-#define PM_EVENT_NOTI_NAME      "pm_event"
-#define PM_EVENT_NOTI_PATH      "/opt/share/noti/"PM_EVENT_NOTI_NAME
 
 /**
  * @addtogroup POWER_MANAGER
@@ -57,11 +64,10 @@
 #define LOCKSTATUS_TIMEOUT		3
 #define TELEPHONY_SIGNAL_TIMEOUT	10
 
-#define SET_BRIGHTNESS_IN_BOOTLOADER "/usr/bin/save_blenv SLP_LCD_BRIGHT"
-
 /* default transition, action fuctions */
 static int default_trans(int evt);
 static int default_action(int timeout);
+static int enter_state(int timeout);
 static int default_check(int next);
 
 unsigned int status_flag;
@@ -72,8 +78,17 @@ static void reset_timeout(int timeout);
 int cur_state;
 int old_state;
 static GMainLoop *mainloop;
-guint timeout_src_id;
-static time_t last_t;
+/* CLOCK_MONOTONIC ms of the next timeout transition, 0 : not armed */
+static long long timeout_deadline;
+static int timeout_slack;
+static GSource *timeout_src;
+/* LCD on waits for the lock screen, see start_lock_wait() */
+static guint lock_wait_id;
+static int blon_early;
+/* failed LCD power commands, see lcd_power_done() */
+#define LCD_POWER_RETRY		2
+static int lcd_retry;
+static int lcd_stuck_off;
 
 struct state states[S_END] = {
 	{S_START, default_trans, default_action, default_check,},
@@ -86,7 +101,7 @@ struct state states[S_END] = {
 int (*pm_init_extention) (void *data);
 void (*pm_exit_extention) (void);
 
-static char state_string[5][10] =
+char state_string[S_END][10] =
     { "S_START", "S_NORMAL", "S_LCDDIM", "S_LCDOFF", "S_SLEEP" };
 
 static int trans_table[S_END][EVENT_END] = {
@@ -104,6 +119,7 @@ static int trans_table[S_END][EVENT_END] = {
 #define SHIFT_CHANGE_STATE	7
 #define CHANGE_STATE_BIT	0xF00	/* 1111 0000 0000 */
 #define LOCK_SCREEN_TIMEOUT	5
+#define LOCK_WAIT_TIMEOUT	500	/* ms */
 #define SHIFT_HOLD_KEY_BLOCK	16
 
 #define DEFAULT_NORMAL_TIMEOUT	30
@@ -113,42 +129,194 @@ static int trans_table[S_END][EVENT_END] = {
 
 static int received_sleep_cmd = 0;
 
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open		434
+#endif
+
 typedef struct _node {
 	pid_t pid;
-	int timeout_id;
+	enum state_t state;
+	twheel_timer timer;		/**< lock expiration */
 	gboolean holdkey_block;
+	int pidfd;			/**< becomes readable when pid exits */
+	pm_watch *pidfd_watch;
+	struct _node *prev;
 	struct _node *next;
 } Node;
 
+/*
+ * lock registry
+ * Every lock is indexed by (pid, state) in lock_table and linked in
+ * the list of its state. The counters keep trans_condition and the
+ * holdkey check constant-time.
+ */
+static GHashTable *lock_table;
 static Node *cond_head[S_END];
+static int lock_count[S_END];
+static int holdkey_count[S_END];
+static const unsigned int cond_mask[S_END] = {
+	0, 0, MASK_DIM, MASK_OFF, MASK_SLP
+};
+/* the number of nodes whose owner can only be checked by kill(pid, 0) */
+static int unwatched_owners;
+
+static gboolean lock_owner_exited(int fd, void *data);
+static void del_cond_timeout(twheel_timer *t);
+
+/*
+ * process name cache for the lock logs
+ * An entry is dropped when its process exits, so a reused pid is
+ * never reported with the name of the previous owner.
+ */
+typedef struct {
+	pid_t pid;
+	char *name;
+	int pidfd;
+	pm_watch *watch;
+} pname_entry;
+
+#define PNAME_UNKNOWN	"does not exist now(may be dead without unlock)"
+
+static GHashTable *pname_cache;
 
-static int refresh_app_cond()
+static void free_pname(gpointer data)
 {
-	trans_condition = 0;
+	pname_entry *e = (pname_entry *) data;
 
-	if (cond_head[S_LCDDIM] != NULL)
-		trans_condition = trans_condition | MASK_DIM;
-	if (cond_head[S_LCDOFF] != NULL)
-		trans_condition = trans_condition | MASK_OFF;
-	if (cond_head[S_SLEEP] != NULL)
-		trans_condition = trans_condition | MASK_SLP;
+	pm_poll_del_fd(e->watch);
+	close(e->pidfd);
+	free(e->name);
+	free(e);
+}
 
-	return 0;
+static gboolean pname_owner_exited(int fd, void *data)
+{
+	pname_entry *e = (pname_entry *) data;
+
+	/* free_pname() removes the watch before closing the pidfd */
+	g_hash_table_remove(pname_cache, GINT_TO_POINTER(e->pid));
+	return FALSE;
+}
+
+/*
+ * get the command line of pid, only for the log arguments
+ * The returned string is valid until the next call.
+ */
+static const char *get_pname(pid_t pid)
+{
+	static char buf[PATH_MAX];
+	char path[32];
+	pname_entry *e;
+	int fd, len;
+
+	if (pid <= 0)
+		return PNAME_UNKNOWN;
+
+	if (pname_cache == NULL)
+		pname_cache = g_hash_table_new_full(g_direct_hash,
+				g_direct_equal, NULL, free_pname);
+	e = (pname_entry *) g_hash_table_lookup(pname_cache,
+			GINT_TO_POINTER(pid));
+	if (e != NULL)
+		return e->name;
+
+	snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return PNAME_UNKNOWN;
+	len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (len <= 0)
+		return PNAME_UNKNOWN;
+	buf[len] = '\0';
+
+	/* without an exit notification the name can not be cached */
+	e = (pname_entry *) malloc(sizeof(pname_entry));
+	if (e == NULL)
+		return buf;
+	e->pidfd = syscall(__NR_pidfd_open, pid, 0);
+	if (e->pidfd < 0) {
+		free(e);
+		return buf;
+	}
+	fcntl(e->pidfd, F_SETFD, FD_CLOEXEC);
+	e->watch = pm_poll_add_fd(e->pidfd, pname_owner_exited, e);
+	e->name = strdup(buf);
+	if (e->watch == NULL || e->name == NULL) {
+		pm_poll_del_fd(e->watch);
+		close(e->pidfd);
+		free(e->name);
+		free(e);
+		return buf;
+	}
+	e->pid = pid;
+	g_hash_table_insert(pname_cache, GINT_TO_POINTER(pid), e);
+
+	return e->name;
+}
+
+/* update the shared state page for the clients */
+static void publish_state(void)
+{
+	int timeout[S_END];
+	int i;
+
+	for (i = 0; i < S_END; i++)
+		timeout[i] = states[i].timeout;
+	pm_shm_publish(cur_state, trans_condition, timeout, timeout_deadline);
+}
+
+static guint node_hash(gconstpointer key)
+{
+	const Node *n = (const Node *) key;
+
+	return (guint) n->pid * S_END + n->state;
+}
+
+static gboolean node_equal(gconstpointer a, gconstpointer b)
+{
+	const Node *x = (const Node *) a;
+	const Node *y = (const Node *) b;
+
+	return x->pid == y->pid && x->state == y->state;
+}
+
+/* update trans_condition when the first lock is added or the last is gone */
+static void update_app_cond(enum state_t s_index, int delta)
+{
+	lock_count[s_index] += delta;
+	if (lock_count[s_index] == 1 && delta > 0)
+		trans_condition |= cond_mask[s_index];
+	else if (lock_count[s_index] == 0)
+		trans_condition &= ~cond_mask[s_index];
+	else
+		return;
+
+	publish_state();
+}
+
+static void set_holdkey_block(Node *n, gboolean holdkey_block)
+{
+	holdkey_block = !!holdkey_block;
+	if (n->holdkey_block == holdkey_block)
+		return;
+	n->holdkey_block = holdkey_block;
+	holdkey_count[n->state] += holdkey_block ? 1 : -1;
 }
 
 static Node *find_node(enum state_t s_index, pid_t pid)
 {
-	Node *t = cond_head[s_index];
+	Node key;
 
-	while (t != NULL) {
-		if (t->pid == pid)
-			break;
-		t = t->next;
-	}
-	return t;
+	if (lock_table == NULL)
+		return NULL;
+
+	key.pid = pid;
+	key.state = s_index;
+	return (Node *) g_hash_table_lookup(lock_table, &key);
 }
 
-static Node *add_node(enum state_t s_index, pid_t pid, int timeout_id,
+static Node *add_node(enum state_t s_index, pid_t pid, unsigned int timeout,
 		gboolean holdkey_block)
 {
 	Node *n;
@@ -160,171 +328,189 @@ static Node *add_node(enum state_t s_index, pid_t pid, int timeout_id,
 	}
 
 	n->pid = pid;
-	n->timeout_id = timeout_id;
-	n->holdkey_block = holdkey_block;
+	n->state = s_index;
+	twheel_init_timer(&n->timer, del_cond_timeout);
+	if (timeout > 0)
+		twheel_mod(&n->timer, timeout);
+	n->holdkey_block = FALSE;
+	set_holdkey_block(n, holdkey_block);
+	n->pidfd = -1;
+	n->pidfd_watch = NULL;
+	n->prev = NULL;
 	n->next = cond_head[s_index];
+	if (n->next != NULL)
+		n->next->prev = n;
 	cond_head[s_index] = n;
 
-	refresh_app_cond();
+	if (lock_table == NULL)
+		lock_table = g_hash_table_new(node_hash, node_equal);
+	g_hash_table_insert(lock_table, n, n);
+
+	/* release the lock as soon as the owner exits */
+	if (pid > 0)
+		n->pidfd = syscall(__NR_pidfd_open, pid, 0);
+	if (n->pidfd >= 0) {
+		fcntl(n->pidfd, F_SETFD, FD_CLOEXEC);
+		n->pidfd_watch = pm_poll_add_fd(n->pidfd, lock_owner_exited, n);
+	}
+	if (n->pidfd_watch == NULL) {
+		if (n->pidfd >= 0) {
+			close(n->pidfd);
+			n->pidfd = -1;
+		}
+		unwatched_owners++;
+	}
+
+	update_app_cond(s_index, 1);
 	return n;
 }
 
 static int del_node(enum state_t s_index, Node *n)
 {
-	Node *t;
-	Node *prev;
-
 	if (n == NULL)
 		return 0;
 
-	t = cond_head[s_index];
-	prev = NULL;
-	while (t != NULL) {
-		if (t == n) {
-			if (prev != NULL)
-				prev->next = t->next;
-			else
-				cond_head[s_index] = cond_head[s_index]->next;
-			free(t);
-			break;
-		}
-		prev = t;
-		t = t->next;
+	g_hash_table_remove(lock_table, n);
+	if (n->prev != NULL)
+		n->prev->next = n->next;
+	else
+		cond_head[s_index] = n->next;
+	if (n->next != NULL)
+		n->next->prev = n->prev;
+
+	twheel_del(&n->timer);
+	if (n->pidfd_watch != NULL) {
+		pm_poll_del_fd(n->pidfd_watch);
+		close(n->pidfd);
+	} else {
+		unwatched_owners--;
 	}
-	refresh_app_cond();
+	set_holdkey_block(n, FALSE);
+	free(n);
+
+	update_app_cond(s_index, -1);
 	return 0;
 }
 
-static gboolean del_dim_cond(gpointer data)
+/* release a lock whose timeout expired */
+static void expire_lock(Node *n)
 {
-	Node *tmp = NULL;
-	LOGINFO("delete prohibit dim condition by timeout\n");
+	enum state_t s_index = n->state;
+	pid_t pid = n->pid;
 
-	tmp = find_node(S_LCDDIM, (pid_t) data);
-	del_node(S_LCDDIM, tmp);
+	switch (s_index) {
+		case S_LCDDIM:
+			LOGINFO("delete prohibit dim condition by timeout\n");
+			break;
+		case S_LCDOFF:
+			LOGINFO("delete prohibit off condition by timeout\n");
+			break;
+		default:
+			LOGINFO("delete prohibit sleep condition by timeout\n");
+			break;
+	}
+	del_node(s_index, n);
 
-	if (timeout_src_id == 0)
+	if (timeout_deadline == 0)
 		states[cur_state].trans(EVENT_TIMEOUT);
 
-	return FALSE;
+	if (s_index == S_SLEEP)
+		sysman_inform_inactive(pid);
 }
 
-static gboolean del_off_cond(gpointer data)
+/* lock timeout expired */
+static void del_cond_timeout(twheel_timer *t)
 {
-	Node *tmp = NULL;
-	LOGINFO("delete prohibit off condition by timeout\n");
+	Node *n = twheel_entry(t, Node, timer);
+	pm_rec_lock rec = { n->pid, n->state };
 
-	tmp = find_node(S_LCDOFF, (pid_t) data);
-	del_node(S_LCDOFF, tmp);
+	pm_record(PM_REC_LOCK_TIMEOUT, 0, &rec, sizeof(rec));
+	expire_lock(n);
+}
 
-	if (timeout_src_id == 0)
-		states[cur_state].trans(EVENT_TIMEOUT);
+int pm_expire_lock(pid_t pid, enum state_t s_index)
+{
+	Node *n = find_node(s_index, pid);
 
-	return FALSE;
+	if (n == NULL)
+		return -1;
+
+	expire_lock(n);
+	return 0;
 }
 
-static gboolean del_sleep_cond(gpointer data)
+/* pidfd of a lock owner is readable : the owner exited without unlock */
+static gboolean lock_owner_exited(int fd, void *data)
 {
-	Node *tmp = NULL;
-	LOGINFO("delete prohibit sleep condition by timeout\n");
-
-	tmp = find_node(S_SLEEP, (pid_t) data);
-	del_node(S_SLEEP, tmp);
+	Node *n = (Node *) data;
+	enum state_t s_index = n->state;
+	pid_t pid = n->pid;
+	pm_rec_lock rec = { pid, s_index };
+
+	pm_record(PM_REC_OWNER_EXIT, 0, &rec, sizeof(rec));
+	LOGERR("%d process does not exist, delete the REQ - prohibit state %d ",
+			pid, s_index);
+	del_node(s_index, n);
+	if (s_index == S_SLEEP)
+		sysman_inform_inactive(pid);
 
-	if (timeout_src_id == 0)
+	if (timeout_deadline == 0)
 		states[cur_state].trans(EVENT_TIMEOUT);
 
-	sysman_inform_inactive((pid_t) data);
 	return FALSE;
 }
 
+/*
+ * add a lock of pid on s_index, or refresh the expiration and holdkey
+ * policy of the lock it already holds
+ */
+static void lock_condition(enum state_t s_index, pid_t pid,
+		unsigned int timeout, gboolean holdkey_block)
+{
+	Node *n = find_node(s_index, pid);
+
+	if (n == NULL) {
+		add_node(s_index, pid, timeout, holdkey_block);
+		return;
+	}
+	if (timeout > 0)
+		twheel_mod(&n->timer, timeout);
+	else
+		twheel_del(&n->timer);
+	set_holdkey_block(n, holdkey_block);
+}
+
 /* update transition condition for application requrements */
 static int proc_condition(PMMsg *data)
 {
 	Node *tmp = NULL;
 	unsigned int val = data->cond;
 	pid_t pid = data->pid;
-	int cond_timeout_id = -1;
 	gboolean holdkey_block = 0;
 
 	if (val == 0)
 		return 0;
-	/* for debug */
-	char pname[PATH_MAX];
-	char buf[PATH_MAX];
-	int fd_cmdline;
-	snprintf(buf, PATH_MAX, "/proc/%d/cmdline", pid);
-	fd_cmdline = open(buf, O_RDONLY);
-	if (fd_cmdline < 0) {
-		snprintf(pname, PATH_MAX,
-				"does not exist now(may be dead without unlock)");
-	} else {
-		read(fd_cmdline, pname, PATH_MAX);
-		close(fd_cmdline);
-	}
 
 	if (val & MASK_DIM) {
-		if (data->timeout > 0) {
-			cond_timeout_id =
-				g_timeout_add_full(G_PRIORITY_DEFAULT,
-						data->timeout,
-						(GSourceFunc) del_dim_cond,
-						(gpointer) pid, NULL);
-		}
 		holdkey_block = GET_HOLDKEY_BLOCK_STATE(val);
-		tmp = find_node(S_LCDDIM, pid);
-		if (tmp == NULL)
-			tmp = add_node(S_LCDDIM, pid, cond_timeout_id, holdkey_block);
-		else if (tmp->timeout_id > 0) {
-			g_source_remove(tmp->timeout_id);
-			tmp->timeout_id = cond_timeout_id;
-			tmp->holdkey_block = holdkey_block;
-		}
+		lock_condition(S_LCDDIM, pid, data->timeout, holdkey_block);
 		/* for debug */
 		LOGINFO("[%s] locked by pid %d - process %s\n", "S_NORMAL", pid,
-				pname);
+				get_pname(pid));
 	}
 	if (val & MASK_OFF) {
-		if (data->timeout > 0) {
-			cond_timeout_id =
-				g_timeout_add_full(G_PRIORITY_DEFAULT,
-						data->timeout,
-						(GSourceFunc) del_off_cond,
-						(gpointer) pid, NULL);
-		}
 		holdkey_block = GET_HOLDKEY_BLOCK_STATE(val);
-		tmp = find_node(S_LCDOFF, pid);
-		if (tmp == NULL)
-			tmp = add_node(S_LCDOFF, pid, cond_timeout_id, holdkey_block);
-		else if (tmp->timeout_id > 0) {
-			g_source_remove(tmp->timeout_id);
-			tmp->timeout_id = cond_timeout_id;
-			tmp->holdkey_block = holdkey_block;
-		}
+		lock_condition(S_LCDOFF, pid, data->timeout, holdkey_block);
 		/* for debug */
 		LOGINFO("[%s] locked by pid %d - process %s\n", "S_LCDDIM", pid,
-				pname);
+				get_pname(pid));
 	}
 	if (val & MASK_SLP) {
-		if (data->timeout > 0) {
-			cond_timeout_id =
-				g_timeout_add_full(G_PRIORITY_DEFAULT,
-						data->timeout,
-						(GSourceFunc) del_sleep_cond,
-						(gpointer) pid, NULL);
-		}
-		tmp = find_node(S_SLEEP, pid);
-		if (tmp == NULL)
-			tmp = add_node(S_SLEEP, pid, cond_timeout_id, 0);
-		else if (tmp->timeout_id > 0) {
-			g_source_remove(tmp->timeout_id);
-			tmp->timeout_id = cond_timeout_id;
-			tmp->holdkey_block = 0;
-		}
+		lock_condition(S_SLEEP, pid, data->timeout, 0);
 		sysman_inform_active(pid);
 		/* for debug */
 		LOGINFO("[%s] locked by pid %d - process %s\n", "S_LCDOFF", pid,
-				pname);
+				get_pname(pid));
 	}
 
 	/* UNLOCK(GRANT) condition processing */
@@ -333,41 +519,48 @@ static int proc_condition(PMMsg *data)
 		tmp = find_node(S_LCDDIM, pid);
 		del_node(S_LCDDIM, tmp);
 		LOGINFO("[%s] unlocked by pid %d - process %s\n", "S_LORMAL",
-				pid, pname);
+				pid, get_pname(pid));
 	}
 	if (val & MASK_OFF) {
 		tmp = find_node(S_LCDOFF, pid);
 		del_node(S_LCDOFF, tmp);
 		LOGINFO("[%s] unlocked by pid %d - process %s\n", "S_LCDDIM",
-				pid, pname);
+				pid, get_pname(pid));
 	}
 	if (val & MASK_SLP) {
 		tmp = find_node(S_SLEEP, pid);
 		del_node(S_SLEEP, tmp);
 		sysman_inform_inactive(pid);
 		LOGINFO("[%s] unlocked by pid %d - process %s\n", "S_LCDOFF",
-				pid, pname);
+				pid, get_pname(pid));
 	}
 	val = val >> 8;
 	if (val != 0) {
 		if ((val & 0x1)) {
 			reset_timeout(states[cur_state].timeout);
-			LOGINFO("reset timeout\n", "S_LCDOFF", pid, pname);
+			LOGDBG("reset timeout\n");
 		}
 	} else {
 		/* guard time for suspend */
 		if (cur_state == S_LCDOFF) {
 			reset_timeout(5);
-			LOGINFO("margin timeout (5 seconds)\n");
+			LOGDBG("margin timeout (5 seconds)\n");
 		}
 	}
 
-	if (timeout_src_id == 0)
+	if (timeout_deadline == 0)
 		states[cur_state].trans(EVENT_TIMEOUT);
 
 	return 0;
 }
 
+static void set_cur_state(int next)
+{
+	pm_stats_transition(cur_state, next);
+	old_state = cur_state;
+	cur_state = next;
+}
+
 static int proc_change_state(unsigned int cond)
 {
 	int next_state = 0;
@@ -387,8 +580,7 @@ static int proc_change_state(unsigned int cond)
 		case S_LCDDIM:
 		case S_LCDOFF:
 			/* state transition */
-			old_state = cur_state;
-			cur_state = next_state;
+			set_cur_state(next_state);
 			st = &states[cur_state];
 
 			/* enter action */
@@ -400,14 +592,12 @@ static int proc_change_state(unsigned int cond)
 			LOGINFO("Dangerous requests.");
 			/* at first LCD_OFF and then goto sleep */
 			/* state transition */
-			old_state = cur_state;
-			cur_state = S_LCDOFF;
+			set_cur_state(S_LCDOFF);
 			st = &states[cur_state];
 			if (st->action) {
 				st->action(0);
 			}
-			old_state = cur_state;
-			cur_state = S_SLEEP;
+			set_cur_state(S_SLEEP);
 			st = &states[cur_state];
 			if (st->action) {
 				st->action(0);
@@ -421,15 +611,22 @@ static int proc_change_state(unsigned int cond)
 	return 0;
 }
 
-/* If some changed, return 1 */
+/*
+ * If some changed, return 1
+ * Only the owners without a pidfd watch need to be checked here,
+ * the others are released by lock_owner_exited() when they exit.
+ */
 int check_processes(enum state_t prohibit_state)
 {
 	Node *t = cond_head[prohibit_state];
 	Node *tmp = NULL;
 	int ret = 0;
 
+	if (unwatched_owners == 0)
+		return 0;
+
 	while (t != NULL) {
-		if (kill(t->pid, 0) == -1) {
+		if (t->pidfd_watch == NULL && kill(t->pid, 0) == -1) {
 			LOGERR
 				("%d process does not exist, delete the REQ - prohibit state %d ",
 				 t->pid, prohibit_state);
@@ -449,21 +646,14 @@ int check_processes(enum state_t prohibit_state)
 
 int check_holdkey_block(enum state_t state)
 {
-	Node *t = cond_head[state];
-	int ret = 0;
-
 	LOGINFO("check holdkey block : state of %s", state_string[state]);
 
-	while(t != NULL) {
-		if(t->holdkey_block == true) {
-			ret = 1;
-			LOGINFO("Hold key blocked by pid(%d)!", t->pid);
-			break;
-		}
-		t = t->next;
+	if (holdkey_count[state] > 0) {
+		LOGINFO("Hold key blocked by %d lock(s)!", holdkey_count[state]);
+		return 1;
 	}
 
-	return ret;
+	return 0;
 }
 
 int delete_condition(enum state_t state)
@@ -475,9 +665,6 @@ int delete_condition(enum state_t state)
 	LOGINFO("delete condition : state of %s", state_string[state]);
 
 	while(t != NULL) {
-		if(t->timeout_id > 0) {
-			g_source_remove(t->timeout_id);
-		}
 		tmp = t;
 		t = t->next;
 		LOGINFO("delete node of pid(%d)", tmp->pid);
@@ -526,33 +713,25 @@ void print_info(int fd)
 
 	for (s_index = S_NORMAL; s_index < S_END; s_index++) {
 		Node *t;
-		char pname[PATH_MAX];
-		int fd_cmdline;
 		t = cond_head[s_index];
 
 		while (t != NULL) {
-			snprintf(buf, sizeof(buf), "/proc/%d/cmdline", t->pid);
-			fd_cmdline = open(buf, O_RDONLY);
-			if (fd_cmdline < 0) {
-				snprintf(pname, PATH_MAX,
-						"does not exist now(may be dead without unlock)");
-			} else {
-				read(fd_cmdline, pname, PATH_MAX);
-				close(fd_cmdline);
-			}
 			snprintf(buf, sizeof(buf),
 					" %d: [%s] locked by pid %d - process %s\n",
-					i++, state_string[s_index - 1], t->pid, pname);
+					i++, state_string[s_index - 1], t->pid,
+					get_pname(t->pid));
 			write(fd, buf, strlen(buf));
 			t = t->next;
 		}
 	}
+
+	pm_poll_print_inputs(fd);
 }
 
-/* SIGHUP signal handler 
+/* SIGHUP handler, on the main loop
  * For debug... print info to syslog
  */
-static void sig_hup(int signo)
+static gboolean sig_hup(gpointer data)
 {
 	int fd;
 	char buf[255];
@@ -560,7 +739,7 @@ static void sig_hup(int signo)
 
 	time(&now_time);
 
-	fd = open(PM_STATE_LOG_FILE, O_CREAT | O_WRONLY, 0644);
+	fd = open(runtime_path(PM_STATE_LOG_FILE), O_CREAT | O_WRONLY, 0644);
 	if (fd != -1) {
 		snprintf(buf, sizeof(buf), "\npm_state_log now-time : %d (s)\n\n",
 				(int)now_time);
@@ -573,7 +752,15 @@ static void sig_hup(int signo)
 				received_sleep_cmd);
 		write(fd, buf, strlen(buf));
 
+		snprintf(buf, sizeof(buf), "dropped pm_control messages : %u\n",
+				get_pm_sock_drops());
+		write(fd, buf, strlen(buf));
+
 		print_info(fd);
+
+		snprintf(buf, sizeof(buf), "\nrecent log :\n");
+		write(fd, buf, strlen(buf));
+		pm_log_dump(fd);
 		close(fd);
 	}
 
@@ -582,6 +769,8 @@ static void sig_hup(int signo)
 		print_info(fd);
 		close(fd);
 	}
+
+	return TRUE;
 }
 
 /* timeout handler  */
@@ -589,10 +778,8 @@ gboolean timeout_handler(gpointer data)
 {
 	LOGINFO("Time out state %s\n", state_string[cur_state]);
 
-	if (timeout_src_id != 0) {
-		g_source_remove(timeout_src_id);
-		timeout_src_id = 0;
-	}
+	timeout_deadline = 0;
+	publish_state();
 
 	if ((status_flag & VCALL_FLAG)
 			&& (cur_state == S_LCDOFF || cur_state == S_SLEEP)) {
@@ -604,19 +791,62 @@ gboolean timeout_handler(gpointer data)
 	return FALSE;
 }
 
-static void reset_timeout(int timeout)
+/*
+ * state timer source
+ * It lives as long as the main loop and only follows timeout_deadline,
+ * so moving the deadline never adds or removes a GSource.
+ * The timer may fire up to timeout_slack ms late to share a wakeup.
+ */
+static gboolean timeout_prepare(GSource *src, gint *timeout)
 {
-	if (timeout_src_id != 0) {
-		g_source_remove(timeout_src_id);
-		timeout_src_id = 0;
+	long long now;
+
+	if (timeout_deadline == 0) {
+		*timeout = -1;
+		return FALSE;
 	}
-	if (timeout > 0) {
-		timeout_src_id = g_timeout_add_seconds_full(G_PRIORITY_HIGH,
-				timeout,
-				(GSourceFunc)
-				timeout_handler,
-				NULL, NULL);
+
+	now = get_monotonic_ms();
+	if (now >= timeout_deadline) {
+		*timeout = 0;
+		return TRUE;
 	}
+	*timeout = (gint)(timeout_deadline + timeout_slack - now);
+	return FALSE;
+}
+
+static gboolean timeout_check(GSource *src)
+{
+	return timeout_deadline != 0 && get_monotonic_ms() >= timeout_deadline;
+}
+
+static gboolean timeout_dispatch(GSource *src, GSourceFunc callback,
+		gpointer data)
+{
+	pm_record(PM_REC_TIMEOUT, 0, NULL, 0);
+	timeout_handler(NULL);
+	return TRUE;
+}
+
+static GSourceFuncs timeout_funcs = {
+	.prepare = timeout_prepare,
+	.check = timeout_check,
+	.dispatch = timeout_dispatch,
+	.finalize = NULL,
+};
+
+static void reset_timeout_ms(long long msec)
+{
+	if (msec > 0)
+		timeout_deadline = get_monotonic_ms() + msec;
+	else
+		timeout_deadline = 0;
+	publish_state();
+}
+
+static void reset_timeout(int timeout)
+{
+	reset_timeout_ms((long long)timeout * 1000);
 }
 
 static void sig_usr(int signo)
@@ -645,7 +875,7 @@ static int default_trans(int evt)
 	/* check conditions */
 	while (st->check && !st->check(next_state)) {
 		/* There is a condition. */
-		LOGINFO("%s -> %s : check fail", state_string[cur_state],
+		LOGDBG("%s -> %s : check fail", state_string[cur_state],
 		       state_string[next_state]);
 		if (!check_processes(next_state)) {
 			/* this is valid condition - the application that sent the condition is running now. */
@@ -654,8 +884,7 @@ static int default_trans(int evt)
 	}
 
 	/* state transition */
-	old_state = cur_state;
-	cur_state = next_state;
+	set_cur_state(next_state);
 	st = &states[cur_state];
 
 	/* enter action */
@@ -666,38 +895,172 @@ static int default_trans(int evt)
 	return 0;
 }
 
-/* default enter action function */
+static struct timespec action_start;
+static int action_state = -1;
+
+/*
+ * end of the enter action for the action latency histogram,
+ * called before a suspend or a nested transition is taken
+ */
+static void end_action(void)
+{
+	struct timespec end;
+
+	if (action_state < 0)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	pm_stats_action(action_state,
+			(end.tv_sec - action_start.tv_sec) * 1000000LL +
+			(end.tv_nsec - action_start.tv_nsec) / 1000);
+	action_state = -1;
+}
+
+/* enter action of every state, timed for the action latency histogram */
 static int default_action(int timeout)
+{
+	int ret;
+
+	clock_gettime(CLOCK_MONOTONIC, &action_start);
+	action_state = cur_state;
+	ret = enter_state(timeout);
+	end_action();
+
+	return ret;
+}
+
+static int cancel_lock_wait(void)
+{
+	if (lock_wait_id == 0)
+		return 0;
+	g_source_remove(lock_wait_id);
+	lock_wait_id = 0;
+	return 1;
+}
+
+/* turn the LCD on unless it is on already, and restore the brightness */
+static void show_screen(void)
+{
+	if (!blon_early)
+		backlight_on();
+	backlight_restore();
+}
+
+static void end_lock_wait(void)
+{
+	if (cancel_lock_wait())
+		show_screen();
+}
+
+static gboolean lock_wait_expired(gpointer data)
+{
+	LOGERR("lock screen is not ready in %d ms", LOCK_WAIT_TIMEOUT);
+	lock_wait_id = 0;
+	show_screen();
+	return FALSE;
+}
+
+/*
+ * Do not show the screen before the lock screen is ready. The main loop
+ * keeps running while it waits : the SETTING_LOCK_SCREEN notification
+ * or LOCK_WAIT_TIMEOUT ends the wait.
+ * With PM_SYS_BLON_EARLY, for panels which stay dark until the
+ * brightness is set, the panel powers up during the wait.
+ */
+static void start_lock_wait(void)
+{
+	cancel_lock_wait();
+	if (blon_early)
+		backlight_on();
+
+	if (policy.lock_state != VCONFKEY_IDLE_UNLOCK) {
+		show_screen();
+		return;
+	}
+
+	LOGINFO("wait for the lock screen");
+	lock_wait_id = g_timeout_add_full(G_PRIORITY_DEFAULT, LOCK_WAIT_TIMEOUT,
+					  lock_wait_expired, NULL, NULL);
+	if (lock_wait_id == 0)
+		show_screen();
+}
+
+/*
+ * result of an LCD power command of the HAL worker. A failed command is
+ * retried LCD_POWER_RETRY times, then the state follows the panel : a
+ * panel which stays dark goes to S_LCDOFF until the next input, one
+ * which stays on goes back to S_NORMAL and the timeout tries again.
+ */
+static void lcd_power_done(int onoff, int ret)
+{
+	int on = (cur_state == S_NORMAL || cur_state == S_LCDDIM);
+
+	/* done, or the state does not want it any more */
+	if (ret >= 0 || on != (onoff == STATUS_ON)) {
+		lcd_retry = 0;
+		return;
+	}
+
+	if (lcd_retry < LCD_POWER_RETRY) {
+		lcd_retry++;
+		LOGERR("LCD %s failed (%d), retry %d", on ? "on" : "off", ret,
+		       lcd_retry);
+		if (on)
+			backlight_on();
+		else
+			backlight_off();
+		return;
+	}
+
+	lcd_retry = 0;
+	LOGERR("LCD %s failed (%d), %s follows the panel", on ? "on" : "off",
+	       ret, on ? "S_LCDOFF" : "S_NORMAL");
+	if (on) {
+		lcd_stuck_off = 1;
+		set_cur_state(S_LCDOFF);
+	} else {
+		set_cur_state(S_NORMAL);
+	}
+	states[cur_state].action(states[cur_state].timeout);
+}
+
+/* completions of the display commands, see pm_hal.h */
+static void hal_done(enum hal_channel ch, int arg, int ret)
+{
+	if (ch == HAL_LCD_POWER)
+		lcd_power_done(arg, ret);
+}
+
+static int enter_state(int timeout)
 {
 	int ret;
 	int wakeup_count = -1;
 	char buf[NAME_MAX];
 	char *pkgname = NULL;
-	int i = 0;
-	int lock_state = -1;
 
 	if (cur_state != old_state && cur_state != S_SLEEP)
 		set_setting_pmstate(cur_state);
 
+	/* the LCD goes off again before the lock screen is ready */
+	if (cur_state == S_LCDOFF || cur_state == S_SLEEP)
+		cancel_lock_wait();
+
 	switch (cur_state) {
 		case S_NORMAL:
 			/* normal state : backlight on and restore the previous brightness */
 			if (old_state == S_LCDOFF || old_state == S_SLEEP) {
-				for (i = 0; i < 10; i++) {
-				vconf_get_int(VCONFKEY_IDLE_LOCK_STATE, &lock_state);
-				LOGERR("Idle lock check : %d, vonf : %d", i, lock_state);
-					if (lock_state)
-						break;
-					usleep(50000);
-				}
-				backlight_on();
-				backlight_restore();
+				pm_poll_gate_input(0);
+				start_lock_wait();
 			} else if (old_state == S_LCDDIM)
 				backlight_restore();
 			break;
 
 		case S_LCDDIM:
 			if (old_state == S_LCDOFF || old_state == S_SLEEP) {
+				pm_poll_gate_input(0);
+				backlight_on();
+			} else if (cancel_lock_wait() && !blon_early) {
+				/* dimmed before the lock screen is ready */
 				backlight_on();
 			}
 			/* lcd dim state : dim the brightness */
@@ -705,16 +1068,40 @@ static int default_action(int timeout)
 			break;
 
 		case S_LCDOFF:
-			if (old_state != S_SLEEP && old_state != S_LCDOFF) {
+			if (lcd_stuck_off) {
+				/* the panel did not turn on, it is off */
+				lcd_stuck_off = 0;
+			} else if (old_state != S_SLEEP && old_state != S_LCDOFF) {
 				/* lcd off state : turn off the backlight */
 				backlight_off();
 			}
+			/* wake up only for the events which can turn the lcd on */
+			pm_poll_gate_input(1);
 
 			break;
 
 		case S_SLEEP:
-			/* sleep state : set system mode to SUSPEND */
-			if (0 > plugin_intf->OEM_sys_get_power_wakeup_count(&wakeup_count)) 
+			/*
+			 * the LCD must be off before the suspend : the flush
+			 * reports the last LCD off, lcd_power_done() may retry
+			 * it or leave S_SLEEP
+			 */
+			pm_hal_flush();
+			if (cur_state != S_SLEEP)
+				return 0;
+			if (lcd_retry > 0) {
+				LOGERR("LCD is not off, can not enter suspend mode");
+				goto go_lcd_off;
+			}
+
+			/*
+			 * sleep state : set system mode to SUSPEND. The worker
+			 * is idle after the flush, the lock does not wait
+			 */
+			pm_hal_lock();
+			ret = plugin_intf->OEM_sys_get_power_wakeup_count(&wakeup_count);
+			pm_hal_unlock();
+			if (0 > ret)
 				LOGERR("wakeup count read error");
 
 			if (wakeup_count < 0) {
@@ -722,7 +1109,10 @@ static int default_action(int timeout)
 				goto go_lcd_off;
 			}
 
-			if (0 > plugin_intf->OEM_sys_set_power_wakeup_count(wakeup_count)) {
+			pm_hal_lock();
+			ret = plugin_intf->OEM_sys_set_power_wakeup_count(wakeup_count);
+			pm_hal_unlock();
+			if (0 > ret) {
 				LOGERR("wakeup count write error");
 				goto go_lcd_off;
 			}
@@ -737,6 +1127,8 @@ static int default_action(int timeout)
 	return 0;
 
 go_suspend:
+	pm_blenv_flush();
+	end_action();
 	system_suspend();
 	LOGINFO("system wakeup!!");
 	heynoti_publish(PM_WAKEUP_NOTI_NAME);
@@ -750,6 +1142,7 @@ go_suspend:
 	return 0;
 
 go_lcd_off:
+	end_action();
 	heynoti_publish(PM_WAKEUP_NOTI_NAME);
 	/* Resume !! */
 	states[cur_state].trans(EVENT_DEVICE);
@@ -764,13 +1157,11 @@ go_lcd_off:
 static int default_check(int next)
 {
 	int trans_cond = trans_condition & MASK_BIT;
-	int lock_state = -1;
 
-	LOGINFO("trans_cond : %x", trans_cond);
+	LOGDBG("trans_cond : %x", trans_cond);
 
-	vconf_get_int(VCONFKEY_IDLE_LOCK_STATE, &lock_state);
-	if(lock_state==VCONFKEY_IDLE_LOCK && next != S_SLEEP) {
-		LOGINFO("default_check : LOCK STATE, it's transitable");
+	if(policy.lock_state==VCONFKEY_IDLE_LOCK && next != S_SLEEP) {
+		LOGDBG("default_check : LOCK STATE, it's transitable");
 		return 1;
 	}
 
@@ -803,6 +1194,15 @@ static int get_settings()
 	int ret = -1;
 	char buf[255];
 
+	get_env("PM_TO_SLACK", buf, sizeof(buf));
+	timeout_slack = atoi(buf);
+	if (timeout_slack < 0)
+		timeout_slack = 0;
+	LOGINFO("state timer slack : %d ms", timeout_slack);
+
+	get_env("PM_SYS_BLON_EARLY", buf, sizeof(buf));
+	blon_early = atoi(buf) > 0;
+
 	for (i = 0; i < S_END; i++) {
 		switch (states[i].state) {
 			case S_NORMAL:
@@ -860,18 +1260,17 @@ static void default_saving_mode(int onoff)
 
 static int poll_callback(int condition, PMMsg *data)
 {
-	time_t now;
-
 	if (condition == INPUT_POLL_EVENT) {
 		if (cur_state == S_LCDOFF || cur_state == S_SLEEP)
-			LOGINFO("Power key input");
-		time(&now);
-		if (last_t != now) {
+			LOGDBG("Power key input");
+		/* user activity in the normal state only moves the deadline */
+		if (cur_state == S_NORMAL && old_state == S_NORMAL
+				&& timeout_deadline != 0)
+			reset_timeout(states[S_NORMAL].timeout);
+		else
 			states[cur_state].trans(EVENT_INPUT);
-			last_t = now;
-		}
 	} else if (condition == PM_CONTROL_EVENT) {
-		LOGINFO("process pid(%d) pm_control condition : %x ", data->pid,
+		LOGDBG("process pid(%d) pm_control condition : %x ", data->pid,
 				data->cond);
 
 		if (data->cond & MASK_BIT
@@ -890,12 +1289,9 @@ static int poll_callback(int condition, PMMsg *data)
 
 static int update_setting(int key_idx, int val)
 {
-	char buf[PATH_MAX];
 	int ret = -1;
 	int dim_timeout = -1;
 	int run_timeout = -1;
-	int power_saving_stat = -1;
-	int power_saving_display_stat = -1;
 
 	switch (key_idx) {
 	case SETTING_TO_NORMAL:
@@ -937,7 +1333,7 @@ static int update_setting(int key_idx, int val)
 			status_flag |= CHRGR_FLAG;
 		} else {
 			int bat_state = VCONFKEY_SYSMAN_BAT_NORMAL;
-			vconf_get_int(VCONFKEY_SYSMAN_BATTERY_STATUS_LOW, &bat_state);
+			setting_get_int(VCONFKEY_SYSMAN_BATTERY_STATUS_LOW, &bat_state);
 			if(bat_state < VCONFKEY_SYSMAN_BAT_NORMAL) {
 				power_saving_func(true);
 				status_flag |= LOWBT_FLAG;
@@ -949,11 +1345,11 @@ static int update_setting(int key_idx, int val)
 		if (status_flag & PWRSV_FLAG)
 			   break;
 		set_default_brt(val);
-		snprintf(buf, sizeof(buf), "%s %d", SET_BRIGHTNESS_IN_BOOTLOADER, val);
-		LOGINFO("Brightness set in bl : %d",val);
-		system(buf);
+		pm_blenv_save_brt(val);
 		break;
 	case SETTING_LOCK_SCREEN:
+		if (val != VCONFKEY_IDLE_UNLOCK)
+			end_lock_wait();
 		if (val == VCONFKEY_IDLE_LOCK) {
 			states[S_NORMAL].timeout = LOCK_SCREEN_TIMEOUT;
 			LOGERR("LCD NORMAL timeout is set by %d seconds for lock screen", LOCK_SCREEN_TIMEOUT);
@@ -971,27 +1367,20 @@ static int update_setting(int key_idx, int val)
 		}
 		break;
 	case SETTING_POWER_SAVING:
-		if (val == 1)
-			vconf_get_bool(VCONFKEY_SETAPPL_PWRSV_CUSTMODE_DISPLAY, &power_saving_display_stat);
-		if (power_saving_display_stat != 1)
-			power_saving_display_stat = 0;
-		plugin_intf->OEM_sys_set_display_frame_rate(power_saving_display_stat);
+		set_frame_rate(policy.display_saving);
 		backlight_restore();
 		break;
 	case SETTING_POWER_SAVING_DISPLAY:
-		vconf_get_bool(VCONFKEY_SETAPPL_PWRSV_SYSMODE_STATUS, &power_saving_stat);
-		if (power_saving_stat == 1) {
-			if (val == 1)
-				power_saving_display_stat = 1;
-			else
-				power_saving_display_stat = 0;
-			plugin_intf->OEM_sys_set_display_frame_rate(power_saving_display_stat);
+		if (policy.power_saving == 1) {
+			set_frame_rate(policy.display_saving);
 			backlight_restore();
 		}
 		break;
 	default:
 		return -1;
 	}
+	if (key_idx == SETTING_TO_NORMAL || key_idx == SETTING_LOCK_SCREEN)
+		publish_state();
 	return 0;
 }
 
@@ -1002,7 +1391,6 @@ static void check_seed_status(void)
 	int bat_state = VCONFKEY_SYSMAN_BAT_NORMAL;
 	int max_brt = 0;
 	int brt = 0;
-	int lock_state = -1;
 
 	/* Charging check */
 	if ((get_charging_status(&tmp) == 0) && (tmp > 0)) {
@@ -1013,16 +1401,17 @@ static void check_seed_status(void)
 	if (ret != 0 || tmp < 0) {
 		LOGINFO("fail to read vconf value for brightness");
 
-		if (0 > plugin_intf->OEM_sys_get_backlight_max_brightness(DEFAULT_DISPLAY, &max_brt))
+		ret = get_max_brt(&max_brt);
+		if (0 > ret)
 			brt = 7;
 		else
 			brt = max_brt * 0.4;
 		if(tmp < 0)
-			vconf_set_int(VCONFKEY_SETAPPL_LCD_BRIGHTNESS, brt);
+			setting_set_int(VCONFKEY_SETAPPL_LCD_BRIGHTNESS, brt);
 		tmp = brt;
 	}
 
-	vconf_get_int(VCONFKEY_SYSMAN_BATTERY_STATUS_LOW, &bat_state);
+	setting_get_int(VCONFKEY_SYSMAN_BATTERY_STATUS_LOW, &bat_state);
 	if(bat_state >= VCONFKEY_SYSMAN_BAT_WARNING_LOW || bat_state == -1 ) {
 		LOGINFO("Set brightness from Setting App. %d", tmp);
 		set_default_brt(tmp);
@@ -1039,13 +1428,12 @@ static void check_seed_status(void)
 	if ((get_usb_status(&tmp) == 0) && (tmp > 0)) {
 		tmp = readpid(USB_CON_PIDFILE);
 		if (tmp != -1) {
-			add_node(S_SLEEP, tmp, -1, 0);
+			add_node(S_SLEEP, tmp, 0, 0);
 		}
 	}
 
 	/* lock screen check */
-	ret = vconf_get_int(VCONFKEY_IDLE_LOCK_STATE, &lock_state);
-	if(lock_state == VCONFKEY_IDLE_LOCK) {
+	if(policy.lock_state == VCONFKEY_IDLE_LOCK) {
 		states[S_NORMAL].timeout = LOCK_SCREEN_TIMEOUT;
 		LOGERR("LCD NORMAL timeout is set by %d seconds for lock screen", LOCK_SCREEN_TIMEOUT);
 	}
@@ -1068,150 +1456,20 @@ static char *errMSG[INIT_END] = {
 	[INIT_FIFO] = "FIFO poll init error",
 };
 
-/* logging indev_list for debug */
-void printglist()
-{
-        int i;
-        guint total=0;
-        indev *tmp;
-
-        total=g_list_length(indev_list);
-        LOGINFO("***** total list : %d *****",total);
-        for(i=0;i<total;i++) {
-                tmp=(indev*)(g_list_nth(indev_list, i)->data);
-                LOGINFO("* %d | path:%s, gsource:%d, gfd:%d", i, tmp->dev_path, tmp->dev_src, tmp->dev_fd);
-                if(i==total-1 && g_list_nth(indev_list, i)->next==NULL)
-                        LOGINFO("okokok");
-        }
-        LOGINFO("***************************\n");
-}
-
-static GList *find_glist(GList *glist, char *path)
-{
-	int i;
-	guint total=0;
-	indev *tmp;
-
-	total=g_list_length(indev_list);
-	for(i=0;i<total;i++) {
-		tmp=(indev*)(g_list_nth(indev_list, i)->data);
-		if(!strcmp(tmp->dev_path, path)){
-			LOGINFO("nth : %d, path:%s, gsource:%d, gfd:%d", i, tmp->dev_path, tmp->dev_src, tmp->dev_fd);
-			return g_list_nth(indev_list, i);
-		}
-	}
-	return NULL;
-}
-
-static void input_cb(void* data)
-{
-	FILE *fp;
-	char input_act[NAME_MAX], input_path[MAX_INPUT];
-	char args[NAME_MAX + MAX_INPUT];
-	int i, ret = -1;
-	GList *glist = NULL;
-
-	fp = fopen((char *) data, "r");
-	if (fp == NULL) {
-		LOGERR("input file open fail");
-		return ;
-	}
-
-	while (fgets(args, NAME_MAX + MAX_INPUT, fp) != NULL){
-		if( args[strlen(args)-1] != '\n'){
-			LOGERR("input file must be terminated with new line character\n");
-			break;
-		}
-		args[strlen(args) - 1] = '\0';
-		for(i = 0; i< NAME_MAX + MAX_INPUT; i++){
-			if(args[i] == ' '){
-				if( i >= NAME_MAX ){
-					LOGERR("bsfile name is over the name_max(255)\n");
-					break;
-				}
-				strncpy(input_act, args, i < NAME_MAX ? i : NAME_MAX);
-				input_act[i]='\0';
-				strncpy(input_path, args + i + 1, MAX_INPUT);
-				input_path[MAX_INPUT - 1] = '\0';
-
-				if( !strcmp("add", input_act) ){
-					LOGINFO("add input path:%s",input_path);
-
-					ret=init_pm_poll_input(poll_callback, input_path);
-
-				} else if ( !strcmp("remove", input_act) ){
-					glist=find_glist(indev_list, input_path);
-					if(glist != NULL){
-						LOGINFO("remove input dev");
-						g_source_remove_poll(((indev*)(glist->data))->dev_src, ((indev*)(glist->data))->dev_fd);
-						g_source_destroy(((indev*)(glist->data))->dev_src);
-						close(((indev*)(glist->data))->dev_fd->fd);
-						g_free(((indev*)(glist->data))->dev_fd);
-						free(((indev*)(glist->data))->dev_path);
-						indev_list=g_list_remove(indev_list, glist->data);
-					}
-					ret=0;
-				}
-				/* debug */
-				printglist();
-
-				break;
-			}
-		}
-		if(ret<0)
-			break;
-	}
-	fclose(fp);
-
-	if ( ret != -1) {
-		fp = fopen((char *) data, "w");
-		if (fp == NULL) {
-			return ;
-		}
-		fclose(fp);
-	}
-
-	return ;
-}
-
-static int set_noti(int noti_fd)
+/* hotplug of an input device, see pm_uevent.h */
+static void input_changed(int add, const char *path)
 {
-	int fd;
-	char buf[PATH_MAX];
-
-	noti_fd = heynoti_init();
-	if (noti_fd < 0) {
-		LOGERR("heynoti_init error");
-		return -1;
-	}
-
-	if (heynoti_subscribe(noti_fd, PM_EVENT_NOTI_NAME, input_cb, PM_EVENT_NOTI_PATH) < 0) {
-		LOGERR("input file change noti add failed(%s). %s", buf, strerror(errno));
-		return -1;
-	} else {
-		LOGERR("input file change noti add ok");
-	}
-
-	if (heynoti_attach_handler(noti_fd) < 0) {
-		LOGERR("heynoti_attach_handler error");
-		return -1;
-	}
-
-	return 0;
+	/* a node added again after a flap is a new device, reopen it */
+	exit_pm_poll_input(pm_poll_find_input(path));
+	if (add)
+		init_pm_poll_input(poll_callback, path);
 }
 
-static int unset_noti(int noti_fd)
+/* a charger change is handled by the system before the suspend */
+static void power_changed(const char *name)
 {
-	if (noti_fd < 0) {
-		LOGINFO("set noti already failed. nothing to do in unset");
-		return 0;
-	}
-
-	if (heynoti_unsubscribe(noti_fd, PM_EVENT_NOTI_NAME, input_cb) < 0 || heynoti_detach_handler(noti_fd) < 0) {
-		LOGERR("heynoti unsubsribe or detach error");
-		return -1;
-	}
-	return 0;
+	if (cur_state == S_LCDOFF)
+		reset_timeout(states[S_LCDOFF].timeout);
 }
 
 /**
@@ -1235,17 +1493,20 @@ void start_main(unsigned int flags)
 	signal(SIGINT, sig_quit);
 	signal(SIGTERM, sig_quit);
 	signal(SIGQUIT, sig_quit);
-	signal(SIGHUP, sig_hup);
-	signal(SIGCHLD, SIG_IGN);
+	/* the dump allocates, it runs on the main loop */
+	g_unix_signal_add(SIGHUP, sig_hup, NULL);
+	/* the children are reaped by waitpid() of the code which started them */
+	signal(SIGCHLD, SIG_DFL);
 	signal(SIGUSR1, sig_usr);
 
 	mainloop = g_main_loop_new(NULL, FALSE);
 	power_saving_func = default_saving_mode;
+	init_pm_stats(cur_state);
+
+	timeout_src = g_source_new(&timeout_funcs, sizeof(GSource));
+	g_source_set_priority(timeout_src, G_PRIORITY_HIGH);
+	g_source_attach(timeout_src, NULL);
 
-	/* noti init for new input device like bt mouse */
-	int noti_fd;
-	indev_list=NULL;
-	set_noti(noti_fd);
 
 	for (i = INIT_SETTING; i < INIT_END; i++) {
 		switch (i) {
@@ -1268,6 +1529,17 @@ void start_main(unsigned int flags)
 	}
 
 	if (i == INIT_END) {
+		if (init_pm_shm() < 0)
+			LOGERR("state page init error");
+		if (init_twheel() < 0)
+			LOGERR("lock timer wheel init error");
+		if (init_pm_query() < 0)
+			LOGERR("query socket init error");
+		if (init_pm_hal(hal_done) < 0)
+			LOGERR("display worker init error, the calls run in the main loop");
+		/* hotplug of new input devices like a bt mouse */
+		if (init_pm_uevent(input_changed, power_changed) < 0)
+			LOGERR("uevent listener init error");
 		check_seed_status();
 
 		if (pm_init_extention != NULL)
@@ -1275,6 +1547,7 @@ void start_main(unsigned int flags)
 
 		if (flags & WITHOUT_STARTNOTI) {	/* start without noti */
 			LOGINFO("Start Power managing without noti");
+			pm_stats_transition(cur_state, S_NORMAL);
 			cur_state = S_NORMAL;
 			set_setting_pmstate(cur_state);
 			reset_timeout(states[S_NORMAL].timeout);
@@ -1293,12 +1566,21 @@ void start_main(unsigned int flags)
 				exit_sysfs();
 				break;
 			case INIT_POLL:
-				unset_noti(noti_fd);
+				exit_pm_uevent();
+				exit_pm_blenv();
+				exit_pm_hal();
+				exit_pm_query();
+				exit_twheel();
 				exit_pm_poll();
 				break;
 		}
 	}
 
+	exit_pm_shm();
+
+	g_source_destroy(timeout_src);
+	g_source_unref(timeout_src);
+
 	if (pm_exit_extention != NULL)
 		pm_exit_extention();
 
@@ -59,11 +59,13 @@ enum state_t {
 /* 
  * Global variables
  *   cur_state   : current state
+ *   state_string: state names
  *   states      : state definitions
  *   trans_table : state transition table
  */
 int cur_state;
 int old_state;
+extern char state_string[S_END][10];
 
 /*
  * @brief State structure
@@ -84,6 +86,26 @@ int (*pm_init_extention) (void *data);		/**< extention init function */
 void (*pm_exit_extention) (void);		/**< extention exit function */
 int check_processes(enum state_t prohibit_state);
 
+/*
+ * release the lock of pid on s_index as if its timeout expired
+ * (used by pm_replay to replay the recorded lock timeouts)
+ *
+ * @return 0 : success, -1 : no such lock
+ */
+int pm_expire_lock(pid_t pid, enum state_t s_index);
+
+/*
+ * state timeout handler
+ */
+gboolean timeout_handler(gpointer data);
+
+/*
+ * write the timeouts, the current state and the locks as text
+ *
+ * @param[in] fd file descriptor to write
+ */
+void print_info(int fd);
+
 /*
  * Power manager Main loop
  *
@@ -16,6 +16,8 @@
 
 #include <dlfcn.h>
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "util.h"
 #include "pm_device_plugin.h"
@@ -25,12 +27,20 @@ static void *dlopen_handle;
 int _pm_devman_plugin_init()
 {
 	char *error;
+	char *path;
 
-	dlopen_handle = dlopen(DEVMAN_PLUGIN_PATH, RTLD_NOW);
+	/* e.g. the file backed stub plugin on a build host */
+	path = getenv("PM_DEVMAN_PLUGIN");
+	if (path == NULL || path[0] == '\0')
+		path = DEVMAN_PLUGIN_PATH;
+
+	dlopen_handle = dlopen(path, RTLD_NOW);
 	if (!dlopen_handle) {
-		LOGERR("dlopen() failed");
+		LOGERR("dlopen() failed: %s", dlerror());
 		return -1;
 	}
+	if (strcmp(path, DEVMAN_PLUGIN_PATH))
+		LOGINFO("device plugin : %s", path);
 
 	const OEM_sys_devman_plugin_interface *(*get_devman_plugin_interface) ();
 	get_devman_plugin_interface = dlsym(dlopen_handle, "OEM_sys_get_devman_plugin_interface");
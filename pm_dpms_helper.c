@@ -0,0 +1,72 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_dpms_helper.c
+ * @version	0.1
+ * @brief	Resident X DPMS helper of the power manager
+ *
+ * Started by power_manager -x with a socket on stdin and stdout. It
+ * reads one command per line, "on" or "off", forces the DPMS level
+ * and answers "ok" or "err". It exits when the socket is closed.
+ * pm_dpms_stub.sh speaks the same protocol without X.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <X11/Xlib.h>
+#include <X11/extensions/dpms.h>
+
+static int force_level(Display *dpy, CARD16 level)
+{
+	if (!DPMSCapable(dpy))
+		return -1;
+	if (!DPMSForceLevel(dpy, level))
+		return -1;
+	XSync(dpy, False);
+
+	return 0;
+}
+
+int main(void)
+{
+	Display *dpy;
+	char line[32];
+	int ret;
+
+	dpy = XOpenDisplay(NULL);
+	if (dpy == NULL) {
+		fprintf(stderr, "pm_dpms_helper: cannot open display\n");
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), stdin) != NULL) {
+		/* "on" is standby, like xset dpms force standby */
+		if (!strcmp(line, "on\n"))
+			ret = force_level(dpy, DPMSModeStandby);
+		else if (!strcmp(line, "off\n"))
+			ret = force_level(dpy, DPMSModeOff);
+		else
+			ret = -1;
+
+		fputs(ret < 0 ? "err\n" : "ok\n", stdout);
+		fflush(stdout);
+	}
+
+	XCloseDisplay(dpy);
+	return 0;
+}
@@ -0,0 +1,29 @@
+#!/bin/sh
+#
+# Stand-in for pm_dpms_helper, for tests without X :
+#   PM_DPMS_HELPER=/path/to/pm_dpms_stub.sh power_manager -x ...
+#
+# The last command goes to $PM_STUB_DIR/dpms ("on" or "off") and every
+# command is appended to $PM_STUB_DIR/dpms.log. PM_DPMS_STUB_DELAY
+# delays the answers, in seconds, and PM_DPMS_STUB_FAIL=1 answers "err".
+
+dir=${PM_STUB_DIR:-/tmp/pm_stub}
+mkdir -p "$dir"
+
+while read cmd; do
+	[ -n "$PM_DPMS_STUB_DELAY" ] && sleep "$PM_DPMS_STUB_DELAY"
+	echo "$cmd" >> "$dir/dpms.log"
+	case "$cmd" in
+	on|off)
+		echo "$cmd" > "$dir/dpms"
+		if [ "$PM_DPMS_STUB_FAIL" = "1" ]; then
+			echo err
+		else
+			echo ok
+		fi
+		;;
+	*)
+		echo err
+		;;
+	esac
+done
@@ -0,0 +1,334 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_hal.c
+ * @version	0.1
+ * @brief	Power manager display HAL worker
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "util.h"
+#include "pm_poll.h"
+#include "pm_hal.h"
+
+typedef struct {
+	hal_func func;
+	int arg;
+	unsigned int seq;	/* queue order, 0 : nothing pending */
+	long long queued;	/* us */
+} hal_cmd;
+
+typedef struct {
+	unsigned int submitted;
+	unsigned int coalesced;
+	unsigned int done;
+	unsigned int failed;
+	unsigned int failed_reported;
+	int last_ret;
+	long long max_latency;	/* us, from the queueing to the end */
+} hal_stat;
+
+typedef struct {
+	int arg;
+	int ret;
+	unsigned int seq;	/* completion order, 0 : reported */
+} hal_result;
+
+static const char *channel_name[HAL_CHANNELS] =
+    { "lcd_power", "brightness", "frame_rate" };
+
+static pthread_mutex_t hal_lock = PTHREAD_MUTEX_INITIALIZER;
+/* held during a plugin call, the plugin is not thread safe */
+static pthread_mutex_t call_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t idle_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t worker;
+static int running;
+static int quit;
+static int busy;
+
+static hal_cmd pending[HAL_CHANNELS];
+static unsigned int next_seq;
+static hal_stat stats[HAL_CHANNELS];
+/* last completion of each channel, for the done callback */
+static hal_result results[HAL_CHANNELS];
+static unsigned int next_done;
+static hal_done_func done_cb;
+
+static int efd = -1;
+static pm_watch *efd_watch;
+
+static long long now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* the oldest pending channel, -1 : none. call with hal_lock held */
+static int next_channel(void)
+{
+	int i, ch = -1;
+
+	for (i = 0; i < HAL_CHANNELS; i++) {
+		if (pending[i].seq == 0)
+			continue;
+		if (ch < 0 || pending[i].seq < pending[ch].seq)
+			ch = i;
+	}
+	return ch;
+}
+
+static void *hal_worker(void *data)
+{
+	uint64_t one = 1;
+	hal_cmd cmd;
+	long long latency;
+	int ch, ret;
+
+	pthread_mutex_lock(&hal_lock);
+	while (!quit) {
+		ch = next_channel();
+		if (ch < 0) {
+			busy = 0;
+			pthread_cond_broadcast(&idle_cond);
+			pthread_cond_wait(&work_cond, &hal_lock);
+			continue;
+		}
+		cmd = pending[ch];
+		pending[ch].seq = 0;
+		busy = 1;
+		pthread_mutex_unlock(&hal_lock);
+
+		pthread_mutex_lock(&call_lock);
+		ret = cmd.func(cmd.arg);
+		pthread_mutex_unlock(&call_lock);
+		latency = now_us() - cmd.queued;
+
+		pthread_mutex_lock(&hal_lock);
+		stats[ch].done++;
+		stats[ch].last_ret = ret;
+		if (ret < 0)
+			stats[ch].failed++;
+		if (latency > stats[ch].max_latency)
+			stats[ch].max_latency = latency;
+		results[ch].arg = cmd.arg;
+		results[ch].ret = ret;
+		results[ch].seq = ++next_done;
+		write(efd, &one, sizeof(one));
+	}
+	busy = 0;
+	pthread_cond_broadcast(&idle_cond);
+	pthread_mutex_unlock(&hal_lock);
+
+	return NULL;
+}
+
+/*
+ * report the completions to the done callback, on the main thread.
+ * The callback runs without hal_lock, it may submit a new command.
+ */
+static void hal_report(void)
+{
+	hal_result done[HAL_CHANNELS];
+	int order[HAL_CHANNELS];
+	int i, j, n = 0;
+
+	pthread_mutex_lock(&hal_lock);
+	for (i = 0; i < HAL_CHANNELS; i++) {
+		if (stats[i].failed != stats[i].failed_reported) {
+			LOGERR("%s call failed %u times, last ret %d",
+			       channel_name[i],
+			       stats[i].failed - stats[i].failed_reported,
+			       stats[i].last_ret);
+			stats[i].failed_reported = stats[i].failed;
+		}
+		if (results[i].seq == 0)
+			continue;
+		done[i] = results[i];
+		results[i].seq = 0;
+		/* in completion order */
+		for (j = n; j > 0 && done[order[j - 1]].seq > done[i].seq; j--)
+			order[j] = order[j - 1];
+		order[j] = i;
+		n++;
+	}
+	pthread_mutex_unlock(&hal_lock);
+
+	for (i = 0; i < n && done_cb; i++)
+		done_cb(order[i], done[order[i]].arg, done[order[i]].ret);
+}
+
+/* completions of the worker, on the main loop */
+static gboolean hal_done_handler(int fd, void *data)
+{
+	uint64_t count;
+
+	if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+		LOGERR("hal eventfd read error : %s", strerror(errno));
+
+	hal_report();
+
+	return TRUE;
+}
+
+int pm_hal_submit(enum hal_channel ch, hal_func func, int arg)
+{
+	int ret;
+
+	if (!running) {
+		pthread_mutex_lock(&call_lock);
+		ret = func(arg);
+		pthread_mutex_unlock(&call_lock);
+		return ret < 0 ? -1 : 0;
+	}
+
+	pthread_mutex_lock(&hal_lock);
+	stats[ch].submitted++;
+	if (pending[ch].seq != 0)
+		stats[ch].coalesced++;
+	pending[ch].func = func;
+	pending[ch].arg = arg;
+	pending[ch].seq = ++next_seq;
+	pending[ch].queued = now_us();
+	pthread_cond_signal(&work_cond);
+	pthread_mutex_unlock(&hal_lock);
+
+	return 0;
+}
+
+void pm_hal_lock(void)
+{
+	pthread_mutex_lock(&call_lock);
+}
+
+void pm_hal_unlock(void)
+{
+	pthread_mutex_unlock(&call_lock);
+}
+
+void pm_hal_flush(void)
+{
+	if (!running)
+		return;
+
+	pthread_mutex_lock(&hal_lock);
+	while (busy || next_channel() >= 0)
+		pthread_cond_wait(&idle_cond, &hal_lock);
+	pthread_mutex_unlock(&hal_lock);
+
+	hal_report();
+}
+
+void pm_hal_print(int fd)
+{
+	char buf[256];
+	int i, len;
+
+	if (fd < 0)
+		return;
+
+	len = snprintf(buf, sizeof(buf), "%-10s %9s %9s %9s %6s %12s\n",
+		       "channel", "submitted", "coalesced", "done", "failed",
+		       "max(us)");
+	write(fd, buf, len);
+
+	pthread_mutex_lock(&hal_lock);
+	for (i = 0; i < HAL_CHANNELS; i++) {
+		len = snprintf(buf, sizeof(buf),
+			       "%-10s %9u %9u %9u %6u %12lld\n",
+			       channel_name[i], stats[i].submitted,
+			       stats[i].coalesced, stats[i].done,
+			       stats[i].failed, stats[i].max_latency);
+		write(fd, buf, len);
+	}
+	pthread_mutex_unlock(&hal_lock);
+}
+
+int init_pm_hal(hal_done_func done)
+{
+	sigset_t all, old;
+	int ret;
+
+	efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (efd < 0) {
+		LOGERR("eventfd error : %s", strerror(errno));
+		return -1;
+	}
+
+	efd_watch = pm_poll_add_fd(efd, hal_done_handler, NULL);
+	if (efd_watch == NULL) {
+		close(efd);
+		efd = -1;
+		return -1;
+	}
+
+	/* signals are handled by the main thread */
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &old);
+	quit = 0;
+	busy = 1;
+	ret = pthread_create(&worker, NULL, hal_worker, NULL);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (ret != 0) {
+		LOGERR("hal worker error : %s", strerror(ret));
+		pm_poll_del_fd(efd_watch);
+		efd_watch = NULL;
+		close(efd);
+		efd = -1;
+		return -1;
+	}
+	done_cb = done;
+	running = 1;
+
+	return 0;
+}
+
+int exit_pm_hal(void)
+{
+	if (!running)
+		return 0;
+
+	/* the state machine is gone, the last failures are only logged */
+	done_cb = NULL;
+	pm_hal_flush();
+	pthread_mutex_lock(&hal_lock);
+	quit = 1;
+	pthread_cond_signal(&work_cond);
+	pthread_mutex_unlock(&hal_lock);
+	pthread_join(worker, NULL);
+	running = 0;
+
+	hal_done_handler(efd, NULL);
+	pm_poll_del_fd(efd_watch);
+	efd_watch = NULL;
+	close(efd);
+	efd = -1;
+
+	return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_hal.h
+ * @version	0.1
+ * @brief	Power manager display HAL worker
+ *
+ * The display calls of the device plugin run on a worker thread, so a
+ * slow panel driver does not stall the main loop. Each channel has at
+ * most one pending command : a new command replaces the pending one of
+ * its channel and goes to the end of the queue, e.g. on, dim, on leaves
+ * one LCD power and one brightness command. The worker reports the
+ * completions to the main loop through an eventfd, the done callback of
+ * init_pm_hal() gets the last completed command of each channel and its
+ * result there, in completion order. The device plugin is
+ * not thread safe : the other plugin calls are made between pm_hal_lock()
+ * and pm_hal_unlock(), so they never run next to a worker command.
+ * Before init_pm_hal() and after exit_pm_hal() the calls run at once.
+ */
+#ifndef __PM_HAL_H__
+#define __PM_HAL_H__
+
+/**
+ * @addtogroup POWER_MANAGER
+ * @{
+ */
+
+enum hal_channel {
+	HAL_LCD_POWER = 0,
+	HAL_BRIGHTNESS,		/* brightness and dimming */
+	HAL_FRAME_RATE,
+	HAL_CHANNELS
+};
+
+typedef int (*hal_func) (int arg);
+
+/*
+ * completion of a command, on the main loop
+ *
+ * @param[in] arg argument of the command
+ * @param[in] ret return value of the command, < 0 : failed
+ */
+typedef void (*hal_done_func) (enum hal_channel ch, int arg, int ret);
+
+extern int init_pm_hal(hal_done_func done);
+extern int exit_pm_hal(void);
+
+/*
+ * queue func(arg) on the channel
+ *
+ * @return 0 : queued or done, -1 : the call failed at once
+ */
+extern int pm_hal_submit(enum hal_channel ch, hal_func func, int arg);
+
+/*
+ * serialize a device plugin call of the main thread with the worker
+ */
+extern void pm_hal_lock(void);
+extern void pm_hal_unlock(void);
+
+/*
+ * wait until every queued command is done, e.g. before suspend, and
+ * run the done callback of the completions at once
+ */
+extern void pm_hal_flush(void);
+
+/*
+ * print the command counters of each channel
+ */
+extern void pm_hal_print(int fd);
+
+/**
+ * @}
+ */
+
+#endif				/*__PM_HAL_H__ */
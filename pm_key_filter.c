@@ -21,7 +21,6 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
-#include <vconf.h>
 #include <sysman.h>
 
 #include "util.h"
@@ -55,7 +54,7 @@ static int key_combination = KEY_COMBINATION_STOP;
 
 void unlock()
 {
-	vconf_set_int(VCONFKEY_IDLE_LOCK_STATE, VCONFKEY_IDLE_UNLOCK);
+	setting_set_int(VCONFKEY_IDLE_LOCK_STATE, VCONFKEY_IDLE_UNLOCK);
 }
 
 static gboolean longkey_pressed(gpointer data)
@@ -64,7 +63,7 @@ static gboolean longkey_pressed(gpointer data)
 	LOGINFO("Power key long pressed!");
 	cancel_lcdoff = 1;
 
-	rc = vconf_get_int(VCONFKEY_TESTMODE_POWER_OFF_POPUP, &val);
+	rc = setting_get_int(VCONFKEY_TESTMODE_POWER_OFF_POPUP, &val);
 
 	if (rc < 0 || val != 1) {
 		if (sysman_call_predef_action(PREDEF_PWROFF_POPUP, 0) <
@@ -88,16 +87,21 @@ static gboolean combination_failed(gpointer data)
 	return 0;
 }
 
-int check_key_filter(int length, char buf[])
+/*
+ * check a batch of whole input events
+ *   return
+ *    1 : every event is ignored, 0 : user activity
+ */
+int check_key_filter(struct input_event *ev, int count)
 {
 	struct input_event *pinput;
 	static struct timeval pressed_time;
 	int ignore = true;
-	int idx = 0;
+	int idx;
 	int val = -1;
 
-	do {
-		pinput = (struct input_event *)&buf[idx];
+	for (idx = 0; idx < count; idx++) {
+		pinput = &ev[idx];
 		if (pinput->type == EV_SYN) ;
 		else if (pinput->type == EV_KEY) {
 			if (pinput->code == KEY_POWER) {
@@ -112,7 +116,7 @@ int check_key_filter(int length, char buf[])
 							/* LCD off forcly */
 							recv_data.pid = -1;
 							recv_data.cond = 0x400;
-							if(vconf_get_int(VCONFKEY_FLASHPLAYER_FULLSCREEN, &val)<0 || val == 0)
+							if(setting_get_int(VCONFKEY_FLASHPLAYER_FULLSCREEN, &val)<0 || val == 0)
 								(*g_pm_callback)(PM_CONTROL_EVENT, &recv_data);
 						}
 					} else
@@ -128,7 +132,7 @@ int check_key_filter(int length, char buf[])
 						longkey_timeout_id = 0;
 					}
 				} else if (pinput->value == KEY_PRESSED) {
-					LOGINFO("power key pressed");
+					LOGDBG("power key pressed");
 					pressed_time.tv_sec = (pinput->time).tv_sec;
 					pressed_time.tv_usec = (pinput->time).tv_usec;
 					if (key_combination == KEY_COMBINATION_STOP) {
@@ -188,7 +192,12 @@ int check_key_filter(int length, char buf[])
 						g_source_remove(combination_timeout_id);
 						combination_timeout_id = 0;
 					}
-					if (pinput->code == KEY_MENU) {
+					if (pinput->code >= BTN_DIGI
+					    && pinput->code <= BTN_TOOL_QUADTAP) {
+						/* BTN_TOUCH and BTN_TOOL_* go with EV_ABS */
+						if (cur_state == S_LCDDIM || cur_state == S_NORMAL)
+							ignore = false;
+					} else if (pinput->code == KEY_MENU) {
 						if (cur_state == S_LCDDIM || cur_state == S_NORMAL || cur_state == S_LCDOFF)
 							ignore = false;
 					} else if (pinput->code == KEY_VOLUMEUP
@@ -217,10 +226,9 @@ int check_key_filter(int length, char buf[])
 			if (cur_state == S_LCDDIM || cur_state == S_NORMAL)
 				ignore = false;
 		}
+	}
 
-		idx += sizeof(struct input_event);
-		if (ignore == true && length <= idx)
-			return 1;
-	} while (length > idx);
+	if (ignore == true)
+		return 1;
 	return 0;
 }
@@ -29,13 +29,18 @@
 #include "pm_device_plugin.h"
 #include "util.h"
 #include "pm_conf.h"
-#include "vconf.h"
 #include "pm_core.h"
+#include "pm_hal.h"
 
 typedef struct _PMSys PMSys;
 struct _PMSys {
 	int def_brt;
 	int dim_brt;
+	/* read once before the HAL worker starts, -1 : unknown */
+	int max_brt;
+	int min_brt;
+	/* level the panel took last, set by the worker, -1 : unknown */
+	int cur_brt;
 
 	int (*sys_suspend) (PMSys *);
 	int (*bl_onoff) (PMSys *, int);
@@ -52,14 +57,18 @@ static bool x_dpms_enable = false;
 
 static void _update_curbrt(PMSys *p)
 {
-	int power_saving_stat = -1;
-	int power_saving_display_stat = -1;
-	vconf_get_bool(VCONFKEY_SETAPPL_PWRSV_SYSMODE_STATUS, &power_saving_stat);
-	if (power_saving_stat == 1)
-		vconf_get_bool(VCONFKEY_SETAPPL_PWRSV_CUSTMODE_DISPLAY, &power_saving_display_stat);
-	if (power_saving_display_stat != 1)
-		power_saving_display_stat = 0;
-	plugin_intf->OEM_sys_get_backlight_brightness(DEFAULT_DISPLAY, &(p->def_brt), power_saving_display_stat);
+	int value;
+
+	pm_hal_lock();
+	plugin_intf->OEM_sys_get_backlight_brightness(DEFAULT_DISPLAY, &(p->def_brt), policy.display_saving);
+	p->cur_brt = p->def_brt;
+	p->max_brt = -1;
+	if (plugin_intf->OEM_sys_get_backlight_max_brightness(DEFAULT_DISPLAY, &value) == 0)
+		p->max_brt = value;
+	p->min_brt = -1;
+	if (plugin_intf->OEM_sys_get_backlight_min_brightness(DEFAULT_DISPLAY, &value) == 0)
+		p->min_brt = value;
+	pm_hal_unlock();
 }
 
 static int _bl_onoff(PMSys *p, int onoff)
@@ -69,15 +78,8 @@ static int _bl_onoff(PMSys *p, int onoff)
 
 static int _bl_brt(PMSys *p, int brightness)
 {
-	int power_saving_stat = -1;
-	int power_saving_display_stat = -1;
-	vconf_get_bool(VCONFKEY_SETAPPL_PWRSV_SYSMODE_STATUS, &power_saving_stat);
-	if (power_saving_stat == 1)
-		vconf_get_bool(VCONFKEY_SETAPPL_PWRSV_CUSTMODE_DISPLAY, &power_saving_display_stat);
-	if (power_saving_display_stat != 1)
-		power_saving_display_stat = 0;
-	int ret = plugin_intf->OEM_sys_set_backlight_brightness(DEFAULT_DISPLAY, brightness, power_saving_display_stat);
-LOGERR("set brightness %d,%d(saving %d) %d", DEFAULT_DISPLAY, brightness, power_saving_display_stat, ret);
+	int ret = plugin_intf->OEM_sys_set_backlight_brightness(DEFAULT_DISPLAY, brightness, policy.display_saving);
+	LOGDBG("set brightness %d,%d(saving %d) %d", DEFAULT_DISPLAY, brightness, policy.display_saving, ret);
 	return ret;
 }
 
@@ -122,19 +124,61 @@ static void _init_pmsys(PMSys *p)
 
 int system_suspend()
 {
-	if (pmsys && pmsys->sys_suspend)
-		return pmsys->sys_suspend(pmsys);
+	int ret = 0;
 
-	return 0;
+	/* the LCD must be off before */
+	pm_hal_flush();
+	if (pmsys && pmsys->sys_suspend) {
+		pm_hal_lock();
+		ret = pmsys->sys_suspend(pmsys);
+		pm_hal_unlock();
+	}
+
+	return ret;
+}
+
+/* HAL worker commands, see pm_hal.h. They run with the plugin locked */
+static int hal_bl_onoff(int onoff)
+{
+	if (onoff == STATUS_OFF) {
+#ifdef ENABLE_X_LCD_ONOFF
+		if (x_dpms_enable == false)
+#endif
+			usleep(30000);
+	}
+	return pmsys->bl_onoff(pmsys, onoff);
+}
+
+static int hal_bl_brt(int level)
+{
+	int ret = pmsys->bl_brt(pmsys, level);
+
+	if (ret >= 0)
+		__sync_lock_test_and_set(&pmsys->cur_brt, level);
+	return ret;
+}
+
+static int hal_bl_dim(int unused)
+{
+	int ret = pmsys->bl_dim(pmsys);
+
+	/* the plugin picks the dim level */
+	if (ret >= 0)
+		__sync_lock_test_and_set(&pmsys->cur_brt, -1);
+	return ret;
+}
+
+static int hal_frame_rate(int rate)
+{
+	return plugin_intf->OEM_sys_set_display_frame_rate(rate);
 }
 
 int backlight_on()
 {
 	LOGINFO("LCD on");
 
-	if (pmsys && pmsys->bl_onoff) {
-		return pmsys->bl_onoff(pmsys, STATUS_ON);
-	}
+	if (pmsys && pmsys->bl_onoff)
+		return pm_hal_submit(HAL_LCD_POWER, hal_bl_onoff, STATUS_ON);
 
 	return 0;
 }
@@ -143,13 +187,8 @@ int backlight_off()
 {
 	LOGINFO("LCD off");
 
-	if (pmsys && pmsys->bl_onoff) {
-#ifdef ENABLE_X_LCD_ONOFF
-		if (x_dpms_enable == false)
-#endif
-			usleep(30000);
-		return pmsys->bl_onoff(pmsys, STATUS_OFF);
-	}
+	if (pmsys && pmsys->bl_onoff)
+		return pm_hal_submit(HAL_LCD_POWER, hal_bl_onoff, STATUS_OFF);
 
 	return 0;
 }
@@ -158,7 +197,7 @@ int backlight_dim()
 {
 	int ret = 0;
 	if (pmsys && pmsys->bl_dim) {
-		ret = pmsys->bl_dim(pmsys);
+		ret = pm_hal_submit(HAL_BRIGHTNESS, hal_bl_dim, 0);
 	}
 	return ret;
 }
@@ -170,24 +209,51 @@ int backlight_restore()
 	if (status_flag & PWRSV_FLAG) {
 		ret = backlight_dim();
 	} else if (pmsys && pmsys->bl_brt) {
-		ret = pmsys->bl_brt(pmsys, pmsys->def_brt);
+		ret = pm_hal_submit(HAL_BRIGHTNESS, hal_bl_brt, pmsys->def_brt);
 	}
 	return ret;
 }
 
+int set_frame_rate(int rate)
+{
+	return pm_hal_submit(HAL_FRAME_RATE, hal_frame_rate, rate);
+}
+
 int set_default_brt(int level)
 {
-	int max_brt;
+	if (pmsys->max_brt >= 0 && level > pmsys->max_brt)
+		level = pmsys->max_brt;
+	pmsys->def_brt = level;
 
-	if (0 == plugin_intf->OEM_sys_get_backlight_max_brightness(DEFAULT_DISPLAY, &max_brt)) {
-		if (level > max_brt) {
-			pmsys->def_brt = max_brt;
+	return 0;
+}
 
-			return 0;
-		}
-	}
-	pmsys->def_brt = level;
+int get_max_brt(int *max)
+{
+	if (pmsys == NULL || pmsys->max_brt < 0)
+		return -1;
+	*max = pmsys->max_brt;
+	return 0;
+}
 
+int get_min_brt(int *min)
+{
+	if (pmsys == NULL || pmsys->min_brt < 0)
+		return -1;
+	*min = pmsys->min_brt;
+	return 0;
+}
+
+int get_cur_brt(int *cur)
+{
+	int value;
+
+	if (pmsys == NULL)
+		return -1;
+	value = __sync_fetch_and_add(&pmsys->cur_brt, 0);
+	if (value < 0)
+		return -1;
+	*cur = value;
 	return 0;
 }
 
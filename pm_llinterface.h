@@ -51,6 +51,17 @@ extern int backlight_restore(void);
 
 extern int set_default_brt(int level);
 
+/*
+ * brightness range read at init and the level the panel took last, the
+ * main loop gets them without waiting for the device plugin
+ *
+ * @return 0 : ok, -1 : unknown
+ */
+extern int get_max_brt(int *max);
+extern int get_min_brt(int *min);
+extern int get_cur_brt(int *cur);
+extern int set_frame_rate(int rate);
+
 extern int check_wakeup_src(void);
 
 #endif
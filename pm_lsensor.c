@@ -23,7 +23,6 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <glib.h>
-#include <vconf.h>
 #include <sensor.h>
 
 #include "pm_core.h"
@@ -49,15 +48,13 @@ static int get_backlight_brightness()
 	int range_value = 0;
 	int ret = -1;
 
-	ret = plugin_intf->OEM_sys_get_backlight_max_brightness(
-				DEFAULT_DISPLAY,&max_value);
+	ret = get_max_brt(&max_value);
 	if (ret != 0 || max_value <= 0) {
 		LOGERR("max brightness is wrong! (%d, %d)", ret, max_value);
 		return FALSE;
 	}
 
-	ret = plugin_intf->OEM_sys_get_backlight_min_brightness(
-				DEFAULT_DISPLAY, &min_value);
+	ret = get_min_brt(&min_value);
 	if (ret != 0 || min_value < 0) {
 		LOGERR("min brightness is wrong! (%d, %d)", ret, min_value);
 		return FALSE;
@@ -100,22 +97,15 @@ static gboolean alc_handler(gpointer data)
 				LOGINFO("fail to load light data : %d",	(int)light_data.values[0]);
 				fault_count++;
 			} else {
-				int tmp_value;
-				int power_saving_stat = -1;
-				int power_saving_display_stat = -1;
-				vconf_get_bool(VCONFKEY_SETAPPL_PWRSV_SYSMODE_STATUS, &power_saving_stat);
-				if (power_saving_stat == 1)
-					vconf_get_bool(VCONFKEY_SETAPPL_PWRSV_CUSTMODE_DISPLAY, &power_saving_display_stat);
-				if (power_saving_display_stat != 1)
-					power_saving_display_stat = 0;
+				int tmp_value = -1;
 				value = min_brightness +
 					(range_brightness * (int)light_data.values[0] / 10);
-				plugin_intf->OEM_sys_get_backlight_brightness(DEFAULT_DISPLAY, &tmp_value, power_saving_display_stat);
+				get_cur_brt(&tmp_value);
 				if (tmp_value != value) {
 					set_default_brt(value);
 					backlight_restore();
 				}
-				LOGINFO("load light data : %d, brightness : %d", (int)light_data.values[0], value);
+				LOGDBG("load light data : %d, brightness : %d", (int)light_data.values[0], value);
 			}
 		}
 	}
@@ -124,7 +114,7 @@ static gboolean alc_handler(gpointer data)
 		if (alc_timeout_id != 0)
 			g_source_remove(alc_timeout_id);
 		alc_timeout_id = 0;
-		vconf_set_int(VCONFKEY_SETAPPL_BRIGHTNESS_AUTOMATIC_INT, SETTING_BRIGHTNESS_AUTOMATIC_OFF);
+		setting_set_int(VCONFKEY_SETAPPL_BRIGHTNESS_AUTOMATIC_INT, SETTING_BRIGHTNESS_AUTOMATIC_OFF);
 		LOGERR("Fault counts is over 5, disable automatic brightness");
 		return FALSE;
 	}
@@ -196,24 +186,16 @@ static int disconnect_sfsvc()
 	return 0;
 }
 
-static int set_alc_function(keynode_t *key_nodes, void *data)
+static void set_alc_function(const char *key, int onoff, void *data)
 {
-	int onoff = 0;
 	int ret = -1;
 	int brt = -1;
 	int default_brt = -1;
 	int max_brt = -1;
 
-	if (key_nodes == NULL) {
-		LOGERR("wrong parameter, key_nodes is null");
-		return -1;
-	}
-
-	onoff = vconf_keynode_get_int(key_nodes);
-
 	if (onoff == SETTING_BRIGHTNESS_AUTOMATIC_ON) {
 		if(connect_sfsvc() < 0)
-			return -1;
+			return;
 
 		/* change alc action func */
 		if (_default_action == NULL)
@@ -234,20 +216,19 @@ static int set_alc_function(keynode_t *key_nodes, void *data)
 		if (ret != 0 || default_brt < 0) {
 			LOGINFO("fail to read vconf value for brightness");
 
-			if (0 > plugin_intf->OEM_sys_get_backlight_max_brightness(DEFAULT_DISPLAY, &max_brt))
+			ret = get_max_brt(&max_brt);
+			if (0 > ret)
 				brt = 7;
 			else
 				brt = max_brt * 0.4;
 			if(default_brt < 0)
-				vconf_set_int(VCONFKEY_SETAPPL_LCD_BRIGHTNESS, brt);
+				setting_set_int(VCONFKEY_SETAPPL_LCD_BRIGHTNESS, brt);
 			default_brt = brt;
 		}
 
 		set_default_brt(default_brt);
 		backlight_restore();
 	}
-
-	return 0;
 }
 
 static gboolean check_sfsvc(gpointer data)
@@ -258,7 +239,7 @@ static gboolean check_sfsvc(gpointer data)
 
 	LOGINFO("register sfsvc");
 
-	vconf_get_int(VCONFKEY_SETAPPL_BRIGHTNESS_AUTOMATIC_INT, &vconf_auto);
+	setting_get_int(VCONFKEY_SETAPPL_BRIGHTNESS_AUTOMATIC_INT, &vconf_auto);
 	if (vconf_auto == SETTING_BRIGHTNESS_AUTOMATIC_ON) {
 		if(connect_sfsvc() < 0)
 			return TRUE;
@@ -287,7 +268,7 @@ static int prepare_lsensor(void *data)
 	int sf_state = 0;
 
 	init_brightness = get_backlight_brightness();
-	vconf_get_int(VCONFKEY_SETAPPL_BRIGHTNESS_AUTOMATIC_INT, &alc_conf);
+	setting_get_int(VCONFKEY_SETAPPL_BRIGHTNESS_AUTOMATIC_INT, &alc_conf);
 
 	if (alc_conf == SETTING_BRIGHTNESS_AUTOMATIC_ON) {
 		g_timeout_add_seconds_full(G_PRIORITY_DEFAULT,
@@ -297,8 +278,8 @@ static int prepare_lsensor(void *data)
 	}
 
 	/* add auto_brt_setting change handler */
-	vconf_notify_key_changed(VCONFKEY_SETAPPL_BRIGHTNESS_AUTOMATIC_INT,
-				 (void *)set_alc_function, NULL);
+	setting_notify_key(VCONFKEY_SETAPPL_BRIGHTNESS_AUTOMATIC_INT,
+			   set_alc_function, NULL);
 
 	if (prev_init_extention != NULL)
 		return prev_init_extention(data);
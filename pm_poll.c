@@ -24,8 +24,11 @@
  * Default input devices are /dev/event0 and /dev/event1
  * User can use "PM_INPUT" for setting another input device poll in an environment file (/etc/profile). 
  * (ex: PM_INPUT=/dev/event0:/dev/event1:/dev/event5 )
+ * All the fds share one epoll set, which is attached to the main loop
+ * as a single GSource.
  */
 
+#define _GNU_SOURCE
 #include <glib.h>
 #include <stdio.h>
 #include <poll.h>
@@ -35,8 +38,17 @@
 #include <string.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <linux/input.h>
+#include <sys/ioctl.h>
+#include <sys/sysmacros.h>
+#include <sys/uio.h>
 
 #include "util.h"
 #include "pm_core.h"
@@ -44,89 +56,519 @@
 
 #define DEV_PATH_DLM	":"
 
+#ifndef KEY_SCREENLOCK
+#define KEY_SCREENLOCK		0x98
+#endif
+
 PMMsg recv_data;
 int (*g_pm_callback) (int, PMMsg *);
 
 #ifdef ENABLE_KEY_FILTER
-extern int check_key_filter(int length, char buf[]);
-#  define CHECK_KEY_FILTER(a, b) do {\
-							if (check_key_filter(a, b) != 0)\
-								return TRUE;\
-							} while (0);
-
+extern int check_key_filter(struct input_event *ev, int count);
+#  define CHECK_KEY_FILTER(a, b) (check_key_filter(a, b) == 0)
 #else
-#  define CHECK_KEY_FILTER(a, b)
+#  define CHECK_KEY_FILTER(a, b) (1)
 #endif
 
 #define DEFAULT_DEV_PATH "/dev/event1:/dev/event0"
 
-static GSource *src;
-static GSourceFuncs *funcs;
-static int sockfd;
+/* maximum number of control datagrams received by one recvmmsg() */
+#define PM_MSG_BATCH	16
+
+/* maximum number of input events handed to the key filter at once */
+#define PM_INPUT_BATCH	64
+
+/* maximum number of ready fds handled by one epoll_wait() */
+#define PM_POLL_EVENTS	16
+
+typedef struct {
+	GSource src;
+	GPollFD gfd;
+} PMSource;
 
-static gboolean pm_check(GSource *src)
+static PMSource *src;
+static int epfd = -1;
+static int sockfd;
+static int dispatching;
+static GSList *dead_watches;
+
+typedef union {
+	PMMsg msg;
+	PMMsgExt ext;
+} PMMsgBuf;
+
+static PMMsgBuf recv_batch[PM_MSG_BATCH];
+static struct sockaddr_un recv_addr[PM_MSG_BATCH];
+static struct iovec recv_iov[PM_MSG_BATCH];
+static struct mmsghdr recv_hdr[PM_MSG_BATCH];
+static char recv_ctrl[PM_MSG_BATCH][CMSG_SPACE(sizeof(uint32_t)) +
+				    CMSG_SPACE(sizeof(struct ucred))];
+static unsigned int sock_drops;
+
+static struct input_event input_batch[PM_INPUT_BATCH];
+
+static PMAck ack_batch[PM_MSG_BATCH];
+static struct iovec ack_iov[PM_MSG_BATCH];
+static struct mmsghdr ack_hdr[PM_MSG_BATCH];
+
+#define BITS_SIZE(n)		(((n) + 7) / 8)
+#define TEST_BIT(b, a)		((a)[(b) / 8] & (1 << ((b) % 8)))
+#define CLEAR_BIT(b, a)		((a)[(b) / 8] &= ~(1 << ((b) % 8)))
+
+static int record_fd = -1;
+
+static int input_gated;
+static unsigned char gate_types[BITS_SIZE(EV_CNT)];
+static unsigned char gate_keys[BITS_SIZE(KEY_CNT)];
+static unsigned char open_types[BITS_SIZE(EV_CNT)];
+static unsigned char open_keys[BITS_SIZE(KEY_CNT)];
+
+/* input device table, see pm_poll.h */
+static indev input_devs[PM_MAX_INPUT];
+static int free_slots[PM_MAX_INPUT];
+static int nr_free;
+static GHashTable *input_by_path;
+static GHashTable *input_by_rdev;
+
+static gboolean pm_check(GSource *source)
 {
-	GSList *fd_list;
-	GPollFD *tmp;
+	PMSource *pmsrc = (PMSource *) source;
 
-	fd_list = src->poll_fds;
-	do {
-		tmp = (GPollFD *) fd_list->data;
-		if ((tmp->revents & (POLLIN | POLLPRI)))
-			return TRUE;
-		fd_list = fd_list->next;
-	} while (fd_list);
+	if ((pmsrc->gfd.revents & (G_IO_IN | G_IO_PRI)))
+		return TRUE;
 
 	return FALSE;
 }
 
-static gboolean pm_dispatch(GSource *src, GSourceFunc callback, gpointer data)
+static gboolean pm_dispatch(GSource *source, GSourceFunc callback,
+			    gpointer data)
 {
-	callback(data);
+	struct epoll_event events[PM_POLL_EVENTS];
+	pm_watch *watch;
+	GSList *l;
+	int i, n;
+
+	n = epoll_wait(epfd, events, PM_POLL_EVENTS, 0);
+	if (n < 0 && errno != EINTR)
+		LOGERR("epoll_wait error : %s", strerror(errno));
+
+	dispatching = 1;
+	for (i = 0; i < n; i++) {
+		watch = (pm_watch *) events[i].data.ptr;
+		/* removed by an earlier callback of this batch */
+		if (watch->fd < 0)
+			continue;
+		if (!watch->callback(watch->fd, watch->data))
+			pm_poll_del_fd(watch);
+	}
+	dispatching = 0;
+
+	for (l = dead_watches; l != NULL; l = l->next)
+		free(l->data);
+	g_slist_free(dead_watches);
+	dead_watches = NULL;
+
 	return TRUE;
 }
 
-static gboolean pm_prepare(GSource *src, gint *timeout)
+static gboolean pm_prepare(GSource *source, gint *timeout)
 {
+	*timeout = -1;
 	return FALSE;
 }
 
-gboolean pm_handler(gpointer data)
+static GSourceFuncs funcs = {
+	.prepare = pm_prepare,
+	.check = pm_check,
+	.dispatch = pm_dispatch,
+	.finalize = NULL,
+};
+
+/* arm a watch stored by the caller, e.g. in an input device slot */
+static int watch_fd(pm_watch *watch, int fd, pm_poll_cb callback, void *data)
+{
+	struct epoll_event ev;
+
+	watch->fd = -1;
+	if (epfd < 0 || fd < 0 || callback == NULL)
+		return -1;
+
+	memset(&ev, 0x0, sizeof(ev));
+	ev.events = EPOLLIN | EPOLLPRI;
+	ev.data.ptr = watch;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		LOGERR("epoll_ctl add fd %d error : %s", fd, strerror(errno));
+		return -1;
+	}
+	watch->fd = fd;
+	watch->callback = callback;
+	watch->data = data;
+
+	return 0;
+}
+
+/* the current epoll batch skips a watch with a negative fd */
+static void unwatch_fd(pm_watch *watch)
 {
-	char buf[1024];
-	struct sockaddr_un clientaddr;
+	if (watch->fd < 0)
+		return;
+
+	if (epoll_ctl(epfd, EPOLL_CTL_DEL, watch->fd, NULL) < 0)
+		LOGERR("epoll_ctl del fd %d error : %s", watch->fd,
+		       strerror(errno));
+	watch->fd = -1;
+}
+
+pm_watch *pm_poll_add_fd(int fd, pm_poll_cb callback, void *data)
+{
+	pm_watch *watch;
+
+	if (epfd < 0 || fd < 0 || callback == NULL)
+		return NULL;
 
-	GPollFD *gpollfd = (GPollFD *) data;
+	watch = (pm_watch *) malloc(sizeof(pm_watch));
+	if (watch == NULL) {
+		LOGERR("Not enough memory, add poll fd %d fail", fd);
+		return NULL;
+	}
+
+	if (watch_fd(watch, fd, callback, data) < 0) {
+		free(watch);
+		return NULL;
+	}
+
+	return watch;
+}
+
+void pm_poll_del_fd(pm_watch *watch)
+{
+	if (watch == NULL || watch->fd < 0)
+		return;
+
+	unwatch_fd(watch);
+
+	/* the current epoll batch may still refer to this watch */
+	if (dispatching)
+		dead_watches = g_slist_prepend(dead_watches, watch);
+	else
+		free(watch);
+}
+
+int pm_poll_set_output(pm_watch *watch, int output)
+{
+	struct epoll_event ev;
+
+	if (watch == NULL || watch->fd < 0)
+		return -1;
+
+	memset(&ev, 0x0, sizeof(ev));
+	ev.events = output ? EPOLLOUT : EPOLLIN | EPOLLPRI;
+	ev.data.ptr = watch;
+	if (epoll_ctl(epfd, EPOLL_CTL_MOD, watch->fd, &ev) < 0) {
+		LOGERR("epoll_ctl mod fd %d error : %s", watch->fd,
+		       strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * track the kernel's drop counter attached by SO_RXQ_OVFL
+ * and get the sender's credentials from SCM_CREDENTIALS
+ */
+static void check_cmsg(struct msghdr *msg, struct ucred *cred)
+{
+	struct cmsghdr *cmsg;
+	uint32_t drops;
+
+	cred->pid = -1;
+	cred->uid = -1;
+
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL;
+	     cmsg = CMSG_NXTHDR(msg, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET)
+			continue;
+		if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+			memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+			if (drops > sock_drops) {
+				LOGERR("pm_sock: %u control messages dropped by kernel",
+				       drops - sock_drops);
+				sock_drops = drops;
+			}
+		} else if (cmsg->cmsg_type == SCM_CREDENTIALS) {
+			memcpy(cred, CMSG_DATA(cmsg), sizeof(*cred));
+		}
+	}
+}
+
+/*
+ * process an extended request and queue its acknowledgement
+ * The ack can be sent only if the client socket has an address.
+ */
+static void proc_ext_msg(PMMsgExt *ext, struct ucred *cred,
+			 struct msghdr *hdr, int *acks)
+{
+	PMMsg msg;
+	PMAck *ack;
+	struct timespec ts;
+	pid_t pid = cred->pid;
+	int result = 0;
+
+	if (pid <= 0) {
+		LOGERR("no credentials for request %u", ext->req_id);
+		result = -EPERM;
+	} else if (ext->op == PM_OP_CONTROL) {
+		msg.pid = pid;
+		msg.cond = ext->cond;
+		msg.timeout = ext->timeout;
+		pm_record(PM_REC_MSG, 0, &msg, sizeof(PMMsg));
+		(*g_pm_callback) (PM_CONTROL_EVENT, &msg);
+	} else if (ext->op == PM_OP_SET_LOG_LEVEL) {
+		if (cred->uid != 0)
+			result = -EPERM;
+		else
+			result = pm_log_set_level(ext->cond);
+		LOGINFO("log level %u requested by pid %d : %d", ext->cond,
+			pid, result);
+	} else {
+		LOGERR("unknown request op %d from pid %d", ext->op, pid);
+		result = -EINVAL;
+	}
+
+	if (hdr->msg_namelen <= sizeof(sa_family_t))
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ack = &ack_batch[*acks];
+	ack->magic = PM_MSG_MAGIC;
+	ack->version = PM_MSG_VERSION;
+	ack->op = ext->op;
+	ack->req_id = ext->req_id;
+	ack->result = result;
+	ack->trans_condition = trans_condition;
+	ack->timestamp = (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+	ack_iov[*acks].iov_base = ack;
+	ack_iov[*acks].iov_len = sizeof(PMAck);
+	memset(&ack_hdr[*acks], 0x0, sizeof(ack_hdr[*acks]));
+	ack_hdr[*acks].msg_hdr.msg_name = hdr->msg_name;
+	ack_hdr[*acks].msg_hdr.msg_namelen = hdr->msg_namelen;
+	ack_hdr[*acks].msg_hdr.msg_iov = &ack_iov[*acks];
+	ack_hdr[*acks].msg_hdr.msg_iovlen = 1;
+	(*acks)++;
+}
+
+static void send_acks(int fd, int acks)
+{
+	int i, n;
+
+	for (i = 0; i < acks; i += n) {
+		n = sendmmsg(fd, &ack_hdr[i], acks - i, MSG_DONTWAIT);
+		if (n > 0)
+			continue;
+		/* the client is gone or does not read its acks */
+		LOGERR("pm_sock: ack for request %u not sent : %s",
+		       ack_batch[i].req_id, strerror(errno));
+		n = 1;
+	}
+}
+
+/* drain every queued control datagram in batches of PM_MSG_BATCH */
+static void recv_control_msgs(int fd)
+{
+	PMMsgBuf *buf;
+	struct ucred cred;
+	int i, n, acks;
+
+	do {
+		for (i = 0; i < PM_MSG_BATCH; i++) {
+			recv_iov[i].iov_base = &recv_batch[i];
+			recv_iov[i].iov_len = sizeof(PMMsgBuf);
+			recv_hdr[i].msg_hdr.msg_name = &recv_addr[i];
+			recv_hdr[i].msg_hdr.msg_namelen = sizeof(recv_addr[i]);
+			recv_hdr[i].msg_hdr.msg_iov = &recv_iov[i];
+			recv_hdr[i].msg_hdr.msg_iovlen = 1;
+			recv_hdr[i].msg_hdr.msg_control = recv_ctrl[i];
+			recv_hdr[i].msg_hdr.msg_controllen = sizeof(recv_ctrl[i]);
+			recv_hdr[i].msg_hdr.msg_flags = 0;
+		}
+
+		n = recvmmsg(fd, recv_hdr, PM_MSG_BATCH, MSG_DONTWAIT, NULL);
+		if (n < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK
+			    && errno != EINTR)
+				LOGERR("recvmmsg error : %s", strerror(errno));
+			return;
+		}
+
+		acks = 0;
+		for (i = 0; i < n; i++) {
+			buf = &recv_batch[i];
+			check_cmsg(&recv_hdr[i].msg_hdr, &cred);
+			if (recv_hdr[i].msg_hdr.msg_flags & MSG_TRUNC) {
+				/* larger than any request, not a cut one */
+				LOGERR("oversized pm_control message dropped");
+			} else if (recv_hdr[i].msg_len == sizeof(PMMsg)) {
+				/* legacy request : pid is taken from the payload */
+				pm_record(PM_REC_MSG, 0, &buf->msg, sizeof(PMMsg));
+				(*g_pm_callback) (PM_CONTROL_EVENT, &buf->msg);
+			} else if (recv_hdr[i].msg_len == sizeof(PMMsgExt)
+				   && buf->ext.magic == PM_MSG_MAGIC
+				   && buf->ext.version == PM_MSG_VERSION) {
+				proc_ext_msg(&buf->ext, &cred,
+					     &recv_hdr[i].msg_hdr, &acks);
+			} else {
+				LOGERR("invalid pm_control message size: %d",
+				       recv_hdr[i].msg_len);
+			}
+		}
+		if (acks > 0)
+			send_acks(fd, acks);
+	} while (n == PM_MSG_BATCH);
+}
+
+void pm_record(int type, int dev, const void *data, int len)
+{
+	struct timespec ts;
+	struct iovec iov[2];
+	pm_rec_hdr hdr;
+
+	if (record_fd < 0)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	hdr.type = type;
+	hdr.len = len;
+	hdr.dev = dev;
+	hdr.time = (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = (void *)data;
+	iov[1].iov_len = len;
+	if (writev(record_fd, iov, 2) != sizeof(hdr) + len) {
+		LOGERR("record write error : %s, recording stopped",
+		       strerror(errno));
+		close(record_fd);
+		record_fd = -1;
+	}
+}
+
+static void init_record(void)
+{
+	pm_rec_file_hdr hdr = { PM_REC_MAGIC, PM_REC_VERSION };
+	char *path;
+
+	path = getenv("PM_RECORD");
+	if (path == NULL || path[0] == '\0')
+		return;
+
+	record_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND |
+			 O_CLOEXEC, 0644);
+	if (record_fd < 0) {
+		LOGERR("Cannot open the record file: %s", path);
+		return;
+	}
+	if (write(record_fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+		close(record_fd);
+		record_fd = -1;
+		return;
+	}
+	LOGINFO("recording to %s", path);
+}
+
+unsigned int get_pm_sock_drops(void)
+{
+	return sock_drops;
+}
+
+/*
+ * read whole input events from a non-blocking input device
+ *
+ * @return the number of events in input_batch, *error is set to the
+ * errno of a device error which ended the batch
+ * @param[out] drained set if the device has no more queued events
+ */
+static int read_input_events(int fd, int *drained, int *error)
+{
+	char *buf = (char *)input_batch;
+	int len = 0;
 	int ret;
-	int clilen = sizeof(clientaddr);
+
+	*drained = 0;
+	*error = 0;
+	while (len < sizeof(input_batch)) {
+		ret = read(fd, buf + len, sizeof(input_batch) - len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			*drained = 1;
+			/* the events read before the error are delivered */
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				*error = errno;
+			break;
+		}
+		if (ret == 0) {
+			*drained = 1;
+			break;
+		}
+		len += ret;
+	}
+
+	if (len % sizeof(struct input_event))
+		LOGERR("partial input event is dropped (%d bytes)",
+		       len % sizeof(struct input_event));
+
+	return len / sizeof(struct input_event);
+}
+
+gboolean pm_handler(int fd, void *data)
+{
+	indev *dev = (indev *) data;
+	int count, drained, error;
+	int input = 0;
 
 	if (g_pm_callback == NULL) {
-		return FALSE;
+		return TRUE;
 	}
-	if (gpollfd->fd == sockfd) {
-		ret =
-		    recvfrom(gpollfd->fd, &recv_data, sizeof(recv_data), 0,
-			     (struct sockaddr *)&clientaddr,
-			     (socklen_t *)&clilen);
-		(*g_pm_callback) (PM_CONTROL_EVENT, &recv_data);
-	} else {
-		ret = read(gpollfd->fd, buf, sizeof(buf));
-		CHECK_KEY_FILTER(ret, buf);
-		(*g_pm_callback) (INPUT_POLL_EVENT, NULL);
+	if (fd == sockfd) {
+		recv_control_msgs(fd);
+		return TRUE;
 	}
 
+	do {
+		count = read_input_events(fd, &drained, &error);
+		if (count > 0)
+			pm_record(PM_REC_INPUT, fd, input_batch,
+				  count * sizeof(struct input_event));
+		if (count > 0 && CHECK_KEY_FILTER(input_batch, count))
+			input = 1;
+		if (error) {
+			/* the device is gone, stop polling until it is removed */
+			LOGERR("input device %s error : %s", dev->dev_path,
+			       strerror(error));
+			unwatch_fd(&dev->dev_watch);
+			break;
+		}
+	} while (!drained);
+
+	if (input)
+		(*g_pm_callback) (INPUT_POLL_EVENT, NULL);
+
 	return TRUE;
 }
 
-static int init_sock(char *sock_path)
+static int init_sock(const char *sock_path)
 {
 	struct sockaddr_un serveraddr;
 	int fd;
+	int on = 1;
 
 	LOGINFO("initialize pm_socket for pm_control library");
 
-	if (sock_path == NULL || strcmp(sock_path, SOCK_PATH)) {
-		LOGERR("invalid sock_path= %s");
+	if (sock_path == NULL || strcmp(sock_path, runtime_path(SOCK_PATH))) {
+		LOGERR("invalid sock_path= %s", sock_path);
 		return -1;
 	}
 
@@ -147,26 +589,268 @@ static int init_sock(char *sock_path)
 		return -1;
 	}
 
+	if (setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) < 0)
+		LOGERR("failed to enable SO_RXQ_OVFL on pm_socket");
+
+	if (setsockopt(fd, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on)) < 0)
+		LOGERR("failed to enable SO_PASSCRED on pm_socket");
+
 	if (chmod(sock_path, (S_IRWXU | S_IRWXG | S_IRWXO)) < 0)	/* 0777 */
 		LOGERR("failed to change the socket permission");
 
-	if (!strcmp(sock_path, SOCK_PATH))
+	if (!strcmp(sock_path, runtime_path(SOCK_PATH)))
 		sockfd = fd;
 
 	LOGINFO("init sock() sueccess!");
 	return fd;
 }
 
+/*
+ * build the evdev masks of the gated and the open devices
+ * The gated masks drop what check_key_filter() ignores in S_LCDOFF :
+ * EV_ABS, the touch and tool buttons of the digitizers and the keys
+ * of lcdoff_ignored[], so a touch panel without the sysfs inhibited
+ * attribute is quiet too. EV_REL and the other keys, e.g. a bt mouse
+ * or KEY_MENU, still turn the LCD on.
+ */
+static void init_gate_masks(void)
+{
+	static const int lcdoff_ignored[] = {
+		KEY_VOLUMEUP, KEY_CAMERA, KEY_EXIT, KEY_PHONE, KEY_CONFIG,
+		KEY_SEARCH, KEY_SCREENLOCK, 0x1DB, 0x1DC, 0x1DD, 0x1DE,
+	};
+	int i;
+
+	memset(open_types, 0xff, sizeof(open_types));
+	memset(open_keys, 0xff, sizeof(open_keys));
+
+	memset(gate_types, 0, sizeof(gate_types));
+	gate_types[EV_SYN / 8] |= 1 << (EV_SYN % 8);
+	gate_types[EV_KEY / 8] |= 1 << (EV_KEY % 8);
+	gate_types[EV_REL / 8] |= 1 << (EV_REL % 8);
+
+	memset(gate_keys, 0xff, sizeof(gate_keys));
+	for (i = 0; i < sizeof(lcdoff_ignored) / sizeof(lcdoff_ignored[0]); i++)
+		CLEAR_BIT(lcdoff_ignored[i], gate_keys);
+	for (i = BTN_DIGI; i <= BTN_TOOL_QUADTAP; i++)
+		CLEAR_BIT(i, gate_keys);
+}
+
+/*
+ * find the sysfs inhibited attribute of a touch device
+ *
+ * @return 0 on success, -1 if the device is not a touch device
+ * or the kernel does not support inhibiting
+ */
+static int get_inhibit_path(int fd, dev_t rdev, char *path, int len)
+{
+	unsigned char abs_bits[BITS_SIZE(ABS_CNT)];
+	unsigned char key_bits[BITS_SIZE(KEY_CNT)];
+
+	memset(abs_bits, 0, sizeof(abs_bits));
+	memset(key_bits, 0, sizeof(key_bits));
+	if (rdev == 0
+	    || ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(abs_bits)), abs_bits) < 0)
+		return -1;
+	ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits);
+
+	if (!TEST_BIT(ABS_MT_POSITION_X, abs_bits)
+	    && !(TEST_BIT(ABS_X, abs_bits) && TEST_BIT(BTN_TOUCH, key_bits)))
+		return -1;
+
+	snprintf(path, len, "/sys/dev/char/%u:%u/device/inhibited",
+		 major(rdev), minor(rdev));
+	if (access(path, W_OK) < 0)
+		return -1;
+
+	return 0;
+}
+
+static void set_inhibit(indev *dev, int inhibit)
+{
+	int fd;
+
+	fd = open(dev->inhibit_path, O_WRONLY | O_CLOEXEC);
+	if (fd < 0 || write(fd, inhibit ? "1" : "0", 1) != 1)
+		LOGERR("%s inhibit %d error : %s", dev->dev_path, inhibit,
+		       strerror(errno));
+	if (fd >= 0)
+		close(fd);
+}
+
+static void gate_input(indev *dev, int gate)
+{
+#ifdef EVIOCSMASK
+	struct input_mask mask;
+
+	mask.type = 0;
+	mask.codes_size = sizeof(gate_types);
+	mask.codes_ptr = (uintptr_t) (gate ? gate_types : open_types);
+	if (ioctl(dev->dev_fd, EVIOCSMASK, &mask) < 0 && errno != ENOTTY)
+		LOGERR("%s event type mask error : %s", dev->dev_path,
+		       strerror(errno));
+
+	mask.type = EV_KEY;
+	mask.codes_size = sizeof(gate_keys);
+	mask.codes_ptr = (uintptr_t) (gate ? gate_keys : open_keys);
+	if (ioctl(dev->dev_fd, EVIOCSMASK, &mask) < 0 && errno != ENOTTY)
+		LOGERR("%s key mask error : %s", dev->dev_path,
+		       strerror(errno));
+#endif
+
+	if (dev->inhibit_path[0] != '\0')
+		set_inhibit(dev, gate);
+}
+
+/* without the key filter every input event is a user activity */
+void pm_poll_gate_input(int gate)
+{
+#ifdef ENABLE_KEY_FILTER
+	int i;
+
+	gate = !!gate;
+	if (gate == input_gated)
+		return;
+	input_gated = gate;
+
+	for (i = 0; i < PM_MAX_INPUT; i++)
+		if (input_devs[i].used)
+			gate_input(&input_devs[i], gate);
+	LOGINFO("input devices %s", gate ? "gated" : "opened");
+#endif
+}
+
+static guint rdev_hash(gconstpointer key)
+{
+	dev_t rdev = *(const dev_t *)key;
+
+	return major(rdev) * 256 + minor(rdev);
+}
+
+static gboolean rdev_equal(gconstpointer a, gconstpointer b)
+{
+	return *(const dev_t *)a == *(const dev_t *)b;
+}
+
+static void init_input_table(void)
+{
+	int i;
+
+	if (input_by_path != NULL)
+		return;
+
+	/* the keys are in the slots */
+	input_by_path = g_hash_table_new(g_str_hash, g_str_equal);
+	input_by_rdev = g_hash_table_new(rdev_hash, rdev_equal);
+	for (i = 0; i < PM_MAX_INPUT; i++) {
+		input_devs[i].dev_fd = -1;
+		input_devs[i].dev_watch.fd = -1;
+		free_slots[i] = PM_MAX_INPUT - 1 - i;
+	}
+	nr_free = PM_MAX_INPUT;
+}
+
+static void exit_input_table(void)
+{
+	int i;
+
+	if (input_by_path == NULL)
+		return;
+
+	for (i = 0; i < PM_MAX_INPUT; i++)
+		if (input_devs[i].used)
+			exit_pm_poll_input(&input_devs[i]);
+	g_hash_table_destroy(input_by_path);
+	g_hash_table_destroy(input_by_rdev);
+	input_by_path = NULL;
+	input_by_rdev = NULL;
+}
+
+indev *pm_poll_find_input(const char *path)
+{
+	if (input_by_path == NULL)
+		return NULL;
+
+	return (indev *) g_hash_table_lookup(input_by_path, path);
+}
+
+static indev *add_input(const char *path)
+{
+	struct stat st;
+	indev *dev;
+	int fd;
+
+	init_input_table();
+
+	dev = pm_poll_find_input(path);
+	if (dev != NULL)
+		return dev;
+
+	if (strlen(path) >= INDEV_PATH_MAX) {
+		LOGERR("input device path is too long : %s", path);
+		return NULL;
+	}
+	if (nr_free == 0) {
+		LOGERR("%d input devices already, %s is not added",
+		       PM_MAX_INPUT, path);
+		return NULL;
+	}
+
+	fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fd == -1) {
+		LOGERR("Cannot open the file: %s", path);
+		return NULL;
+	}
+
+	/* the same device under another name, e.g. a by-path link */
+	if (fstat(fd, &st) < 0 || !S_ISCHR(st.st_mode))
+		st.st_rdev = 0;
+	dev = st.st_rdev ? (indev *) g_hash_table_lookup(input_by_rdev,
+							 &st.st_rdev) : NULL;
+	if (dev != NULL) {
+		LOGINFO("%s is polled as %s already", path, dev->dev_path);
+		close(fd);
+		return dev;
+	}
+
+	dev = &input_devs[free_slots[nr_free - 1]];
+	if (watch_fd(&dev->dev_watch, fd, pm_handler, dev) < 0) {
+		close(fd);
+		return NULL;
+	}
+	nr_free--;
+
+	snprintf(dev->dev_path, sizeof(dev->dev_path), "%s", path);
+	dev->rdev = st.st_rdev;
+	dev->dev_fd = fd;
+	if (get_inhibit_path(fd, dev->rdev, dev->inhibit_path,
+			     sizeof(dev->inhibit_path)) < 0)
+		dev->inhibit_path[0] = '\0';
+	dev->used = 1;
+	g_hash_table_insert(input_by_path, dev->dev_path, dev);
+	if (dev->rdev)
+		g_hash_table_insert(input_by_rdev, &dev->rdev, dev);
+
+	/* a touch device left inhibited must be opened again */
+	if (input_gated || dev->inhibit_path[0] != '\0')
+		gate_input(dev, input_gated);
+	LOGINFO("pm_poll input device file: %s, fd: %d", path, dev->dev_fd);
+
+	return dev;
+}
+
 int init_pm_poll(int (*pm_callback) (int, PMMsg *))
 {
 
 	guint ret;
 	char *dev_paths, *path_tok, *pm_input_env, *save_ptr;
+	const char *sock_path = runtime_path(SOCK_PATH);
 	int dev_paths_size;
 
-	GPollFD *gpollfd;
-
 	g_pm_callback = pm_callback;
+	init_gate_masks();
+	init_record();
+	init_input_table();
 
 	LOGINFO
 	    ("initialize pm poll - input devices and domain socket(libpmapi)");
@@ -176,19 +860,19 @@ int init_pm_poll(int (*pm_callback) (int, PMMsg *))
 		LOGINFO("Getting input device path from environment: %s",
 		       pm_input_env);
 		/* Add 2 bytes for following strncat() */
-		dev_paths_size =  strlen(pm_input_env) + strlen(SOCK_PATH) + strlen(DEV_PATH_DLM) + 1;
+		dev_paths_size =  strlen(pm_input_env) + strlen(sock_path) + strlen(DEV_PATH_DLM) + 1;
 		dev_paths = (char *)malloc(dev_paths_size);
 		snprintf(dev_paths, dev_paths_size, "%s", pm_input_env);
 	} else {
 		/* Add 2 bytes for following strncat() */
-		dev_paths_size = strlen(DEFAULT_DEV_PATH) + strlen(SOCK_PATH) + strlen(DEV_PATH_DLM) + 1;
+		dev_paths_size = strlen(DEFAULT_DEV_PATH) + strlen(sock_path) + strlen(DEV_PATH_DLM) + 1;
 		dev_paths = (char *)malloc(dev_paths_size);
 		snprintf(dev_paths, dev_paths_size, "%s", DEFAULT_DEV_PATH);
 	}
 
 	/* add the UNIX domain socket file path */
 	strncat(dev_paths, DEV_PATH_DLM, strlen(DEV_PATH_DLM));
-	strncat(dev_paths, SOCK_PATH, strlen(SOCK_PATH));
+	strncat(dev_paths, sock_path, strlen(sock_path));
 	dev_paths[dev_paths_size - 1] = '\0';
 
 	path_tok = strtok_r(dev_paths, DEV_PATH_DLM, &save_ptr);
@@ -198,46 +882,41 @@ int init_pm_poll(int (*pm_callback) (int, PMMsg *))
 		return -1;
 	}
 
-	funcs = (GSourceFuncs *) g_malloc(sizeof(GSourceFuncs));
-	funcs->prepare = pm_prepare;
-	funcs->check = pm_check;
-	funcs->dispatch = pm_dispatch;
-	funcs->finalize = NULL;
+	/* one epoll set carries the socket and every input device */
+	epfd = epoll_create(PM_POLL_EVENTS);
+	if (epfd < 0) {
+		LOGERR("epoll_create error : %s", strerror(errno));
+		free(dev_paths);
+		return -1;
+	}
+	fcntl(epfd, F_SETFD, FD_CLOEXEC);
+
+	src = (PMSource *) g_source_new(&funcs, sizeof(PMSource));
+	src->gfd.fd = epfd;
+	src->gfd.events = G_IO_IN;
+	g_source_add_poll((GSource *) src, &src->gfd);
+	g_source_set_priority((GSource *) src, G_PRIORITY_LOW);
+	ret = g_source_attach((GSource *) src, NULL);
+	if (ret == 0) {
+		LOGERR("Failed g_source_attach() in init_pm_poll()");
+		free(dev_paths);
+		return -1;
+	}
 
 	do {
-		src = g_source_new(funcs, sizeof(GSource));
-
-		gpollfd = (GPollFD *) g_malloc(sizeof(GPollFD));
-		gpollfd->events = POLLIN;
-
-		if (strcmp(path_tok, SOCK_PATH) == 0) {
-			gpollfd->fd = init_sock(SOCK_PATH);
+		if (strcmp(path_tok, sock_path) == 0) {
+			if (init_sock(sock_path) < 0
+			    || pm_poll_add_fd(sockfd, pm_handler, NULL) == NULL) {
+				LOGERR("Cannot open the file: %s", path_tok);
+				free(dev_paths);
+				return -1;
+			}
 			LOGINFO("pm_poll domain socket file: %s, fd: %d",
-			       path_tok, gpollfd->fd);
-		} else {
-			gpollfd->fd = open(path_tok, O_RDONLY);
-			LOGINFO("pm_poll input device file: %s, fd: %d",
-			       path_tok, gpollfd->fd);
-		}
-
-		if (gpollfd->fd == -1) {
-			LOGERR("Cannot open the file: %s", path_tok);
-			free(dev_paths);
-			return -1;
-		}
-		g_source_add_poll(src, gpollfd);
-		g_source_set_callback(src, (GSourceFunc) pm_handler,
-				      (gpointer) gpollfd, NULL);
-
-		g_source_set_priority(src, G_PRIORITY_LOW);
-		ret = g_source_attach(src, NULL);
-		if (ret == 0) {
-			LOGERR("Failed g_source_attach() in init_pm_poll()");
+			       path_tok, sockfd);
+		} else if (add_input(path_tok) == NULL) {
 			free(dev_paths);
 			return -1;
 		}
-		g_source_unref(src);
-
 	} while ((path_tok = strtok_r(NULL, DEV_PATH_DLM, &save_ptr)));
 
 	free(dev_paths);
@@ -246,54 +925,80 @@ int init_pm_poll(int (*pm_callback) (int, PMMsg *))
 
 int exit_pm_poll()
 {
-	g_free(funcs);
+	pm_poll_gate_input(0);
+	exit_input_table();
+	if (src != NULL) {
+		g_source_destroy((GSource *) src);
+		g_source_unref((GSource *) src);
+		src = NULL;
+	}
+	close(epfd);
+	epfd = -1;
 	close(sockfd);
-	unlink(SOCK_PATH);
+	unlink(runtime_path(SOCK_PATH));
+	if (record_fd >= 0) {
+		close(record_fd);
+		record_fd = -1;
+	}
 	LOGINFO("pm_poll is finished");
 	return 0;
 }
 
 int init_pm_poll_input(int (*pm_callback)(int , PMMsg * ), const char *path)
 {
-	guint ret;
-	indev *adddev = NULL;
+	indev *adddev;
 
 	g_pm_callback = pm_callback;
 
-	GPollFD *gpollfd;
-	const char *devpath;
-	GSource *devsrc;
-
 	LOGINFO("initialize pm poll for bt %s",path);
-	adddev=(indev *)malloc(sizeof(indev));
-	adddev->dev_fd = (GPollFD *)g_malloc(sizeof(GPollFD));
-	(adddev->dev_fd)->events = POLLIN;
-	(adddev->dev_fd)->fd = open(path, O_RDONLY);
-	if((adddev->dev_fd)->fd == -1) {
+	adddev = add_input(path);
+	if (adddev == NULL) {
 		LOGERR("Cannot open the file for BT: %s",path);
-		g_free(adddev->dev_fd);
-		free(adddev);
 		return -1;
 	}
-	adddev->dev_path = (char *)malloc(strlen(path) + 1);
-	strncpy(adddev->dev_path, path, strlen(path) + 1);
-	adddev->dev_src = g_source_new(funcs, sizeof(GSource));
-	LOGINFO("pm_poll for BT input device file(path: %s, gsource: %d, gpollfd: %d", adddev->dev_path, adddev->dev_src, adddev->dev_fd);
-	indev_list=g_list_append(indev_list, adddev);
-	
-	g_source_add_poll(adddev->dev_src, adddev->dev_fd);
-	
-	g_source_set_callback(adddev->dev_src, (GSourceFunc) pm_handler, (gpointer)adddev->dev_fd, NULL);
-	
-
-	g_source_set_priority(adddev->dev_src, G_PRIORITY_LOW );
-	
-	ret = g_source_attach(adddev->dev_src, NULL);
-	if(ret == 0)
-	{
-		LOGERR("Failed g_source_attach() in init_pm_poll()");
+
+	return 0;
+}
+
+int exit_pm_poll_input(indev *dev)
+{
+	if (dev == NULL || !dev->used)
 		return -1;
-	}
-	g_source_unref(adddev->dev_src);
+
+	LOGINFO("pm_poll input device %s is removed", dev->dev_path);
+	unwatch_fd(&dev->dev_watch);
+	close(dev->dev_fd);
+	dev->dev_fd = -1;
+	g_hash_table_remove(input_by_path, dev->dev_path);
+	if (dev->rdev)
+		g_hash_table_remove(input_by_rdev, &dev->rdev);
+	dev->inhibit_path[0] = '\0';
+	dev->used = 0;
+	free_slots[nr_free++] = dev - input_devs;
+
 	return 0;
 }
+
+void pm_poll_print_inputs(int fd)
+{
+	char buf[2 * INDEV_PATH_MAX];
+	int i, len;
+
+	if (fd < 0)
+		return;
+
+	len = snprintf(buf, sizeof(buf), "Input devices : %d of %d\n",
+		       PM_MAX_INPUT - nr_free, PM_MAX_INPUT);
+	write(fd, buf, len);
+	for (i = 0; i < PM_MAX_INPUT; i++) {
+		indev *dev = &input_devs[i];
+
+		if (!dev->used)
+			continue;
+		len = snprintf(buf, sizeof(buf), " %s fd %d%s%s\n",
+			       dev->dev_path, dev->dev_fd,
+			       dev->dev_watch.fd < 0 ? " (error)" : "",
+			       dev->inhibit_path[0] ? " (touch)" : "");
+		write(fd, buf, len);
+	}
+}
@@ -30,6 +30,7 @@
 #define __PM_POLL_H__
 
 #include<glib.h>
+#include <sys/types.h>
 
 /**
  * @addtogroup POWER_MANAGER
@@ -51,13 +52,70 @@ typedef struct {
 	unsigned int timeout;
 } PMMsg;
 
+/*
+ * Extended request on SOCK_PATH
+ * The daemon processes the requests in order and replies a PMAck with the
+ * same req_id to the sender's address, so a client bound to an address
+ * can pipeline requests and match the acks. The pid of the requester is
+ * taken from SCM_CREDENTIALS, not from the payload.
+ */
+#define PM_MSG_MAGIC	0x504d4d32	/* "PMM2" */
+#define PM_MSG_VERSION	1
+
+enum {
+	PM_OP_CONTROL = 0,	/* lock, unlock or change state by cond */
+	PM_OP_SET_LOG_LEVEL,	/* set the runtime log level to cond (root) */
+};
+
 typedef struct {
-	char *dev_path;
-	GSource *dev_src;
-	GPollFD *dev_fd;
-} indev;
+	unsigned int magic;
+	unsigned short version;
+	unsigned short op;
+	unsigned int req_id;
+	unsigned int cond;
+	unsigned int timeout;
+} PMMsgExt;
+
+typedef struct {
+	unsigned int magic;
+	unsigned short version;
+	unsigned short op;
+	unsigned int req_id;
+	int result;			/* 0 : success, -errno : error */
+	unsigned int trans_condition;	/* after the request is processed */
+	long long timestamp;		/* server CLOCK_MONOTONIC usec */
+} PMAck;
+
+/*
+ * fd watch in the power manager poll set
+ * If the callback returns FALSE, the watch is removed.
+ */
+typedef gboolean (*pm_poll_cb) (int fd, void *data);
 
-GList *indev_list;
+typedef struct {
+	int fd;
+	pm_poll_cb callback;
+	void *data;
+} pm_watch;
+
+/*
+ * Input device table
+ * The input devices live in PM_MAX_INPUT fixed slots, found by device
+ * path or by device number through hash tables in O(1), so a device
+ * opened under two names is polled once. A slot carries the fd, its
+ * watch and the gating state, and is reused when the device goes.
+ */
+#define PM_MAX_INPUT	32
+#define INDEV_PATH_MAX	128
+
+typedef struct {
+	char dev_path[INDEV_PATH_MAX];
+	dev_t rdev;		/* 0 : not a character device */
+	int dev_fd;
+	pm_watch dev_watch;
+	char inhibit_path[INDEV_PATH_MAX];	/* "" : not a touch device */
+	int used;
+} indev;
 
 PMMsg recv_data;
 int (*g_pm_callback) (int, PMMsg *);
@@ -65,6 +123,94 @@ int (*g_pm_callback) (int, PMMsg *);
 extern int init_pm_poll(int (*pm_callback) (int, PMMsg *));
 extern int exit_pm_poll();
 extern int init_pm_poll_input(int (*pm_callback)(int , PMMsg * ), const char *path);
+extern int exit_pm_poll_input(indev *dev);
+
+/*
+ * find an input device by its path
+ *
+ * @return the device, NULL if it is not polled
+ */
+extern indev *pm_poll_find_input(const char *path);
+
+/*
+ * print the input device table
+ */
+extern void pm_poll_print_inputs(int fd);
+
+/*
+ * add a fd to the poll set shared by the input devices and the socket
+ *
+ * @return watch handle on success, NULL on error
+ */
+extern pm_watch *pm_poll_add_fd(int fd, pm_poll_cb callback, void *data);
+extern void pm_poll_del_fd(pm_watch *watch);
+
+/*
+ * call the watch callback when the fd is writable instead of readable
+ *
+ * @param[in] output 1 : writable, 0 : readable
+ */
+extern int pm_poll_set_output(pm_watch *watch, int output);
+
+/*
+ * get the number of control messages the kernel dropped on SOCK_PATH
+ * because the receive queue was full (reported by SO_RXQ_OVFL)
+ */
+extern unsigned int get_pm_sock_drops(void);
+
+/*
+ * gate the input devices while the LCD is off
+ * With gate set, only the events which can turn the LCD on are delivered
+ * and touch devices are inhibited. Hotplugged devices follow the gate.
+ */
+extern void pm_poll_gate_input(int gate);
+
+/*
+ * Record file
+ * If PM_RECORD is set, every input batch, control message and timer
+ * firing is appended to that file, to be fed back by pm_replay.
+ * The file is a pm_rec_file_hdr and a sequence of pm_rec_hdr, each
+ * followed by len bytes of payload.
+ */
+#define PM_REC_MAGIC	0x504d5243	/* "PMRC" */
+#define PM_REC_VERSION	1
+
+enum {
+	PM_REC_INPUT = 1,	/* struct input_event[], dev : fd */
+	PM_REC_MSG,		/* PMMsg */
+	PM_REC_TIMEOUT,		/* state timeout, no payload */
+	PM_REC_LOCK_TIMEOUT,	/* pm_rec_lock */
+	PM_REC_OWNER_EXIT,	/* pm_rec_lock, lock owner exited */
+};
+
+typedef struct {
+	unsigned int magic;
+	unsigned int version;
+} pm_rec_file_hdr;
+
+typedef struct {
+	unsigned short type;
+	unsigned short len;
+	int dev;
+	long long time;		/* CLOCK_MONOTONIC usec */
+} pm_rec_hdr;
+
+typedef struct {
+	pid_t pid;
+	int state;
+} pm_rec_lock;
+
+/*
+ * append a record to the PM_RECORD file, no-op if recording is off
+ */
+extern void pm_record(int type, int dev, const void *data, int len);
+
+/*
+ * handle the readable input device or socket fd
+ *
+ * @param[in] data indev of the input device, NULL for the socket
+ */
+extern gboolean pm_handler(int fd, void *data);
 
 /**
  * @}
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_profile.c
+ * @version	0.1
+ * @brief	Function profiler of the profiling build
+ *
+ * Only linked into power_manager_profile, which is compiled with
+ * -finstrument-functions. Every function entry and exit is counted
+ * and timed, and a report sorted by self time is written at exit to
+ * PM_PROFILE_FILE (default /tmp/pm_profile.txt).
+ * Static functions are reported by their offset in the binary,
+ * use "addr2line -f -e power_manager_profile <offset>" to resolve them.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <dlfcn.h>
+
+#define NO_INSTRUMENT	__attribute__((no_instrument_function))
+
+#define PROFILE_FUNCS	2048	/* power of 2 */
+#define PROFILE_DEPTH	256
+#define DEFAULT_PROFILE_FILE	"/tmp/pm_profile.txt"
+
+typedef struct {
+	void *fn;
+	unsigned long long calls;
+	unsigned long long total;	/* ns, including the callees */
+	unsigned long long self;	/* ns */
+} prof_func;
+
+typedef struct {
+	prof_func *func;
+	unsigned long long start;
+	unsigned long long child;	/* ns spent in the callees */
+} prof_frame;
+
+static prof_func prof_table[PROFILE_FUNCS];
+static unsigned int prof_lost;
+
+static __thread prof_frame prof_stack[PROFILE_DEPTH];
+static __thread int prof_depth;
+
+NO_INSTRUMENT static unsigned long long prof_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* find or add the entry of fn, open addressing */
+NO_INSTRUMENT static prof_func *prof_lookup(void *fn)
+{
+	unsigned int i, h;
+	void *cur;
+
+	h = (unsigned int)((uintptr_t) fn >> 4) * 2654435761U;
+	for (i = 0; i < PROFILE_FUNCS; i++) {
+		prof_func *f = &prof_table[(h + i) & (PROFILE_FUNCS - 1)];
+
+		cur = f->fn;
+		if (cur == fn)
+			return f;
+		if (cur == NULL) {
+			cur = __sync_val_compare_and_swap(&f->fn, NULL, fn);
+			if (cur == NULL || cur == fn)
+				return f;
+		}
+	}
+
+	return NULL;
+}
+
+NO_INSTRUMENT void __cyg_profile_func_enter(void *this_fn, void *call_site)
+{
+	prof_frame *fr;
+
+	if (prof_depth >= PROFILE_DEPTH) {
+		prof_depth++;
+		return;
+	}
+
+	fr = &prof_stack[prof_depth++];
+	fr->func = prof_lookup(this_fn);
+	if (fr->func == NULL)
+		__sync_fetch_and_add(&prof_lost, 1);
+	fr->child = 0;
+	fr->start = prof_now();
+}
+
+NO_INSTRUMENT void __cyg_profile_func_exit(void *this_fn, void *call_site)
+{
+	unsigned long long elapsed;
+	prof_frame *fr;
+
+	if (prof_depth <= 0)
+		return;
+	if (--prof_depth >= PROFILE_DEPTH)
+		return;
+
+	fr = &prof_stack[prof_depth];
+	elapsed = prof_now() - fr->start;
+	if (prof_depth > 0)
+		prof_stack[prof_depth - 1].child += elapsed;
+	if (fr->func == NULL)
+		return;
+
+	__sync_fetch_and_add(&fr->func->calls, 1);
+	__sync_fetch_and_add(&fr->func->total, elapsed);
+	__sync_fetch_and_add(&fr->func->self, elapsed - fr->child);
+}
+
+NO_INSTRUMENT static int prof_cmp(const void *a, const void *b)
+{
+	const prof_func *x = *(const prof_func **)a;
+	const prof_func *y = *(const prof_func **)b;
+
+	if (x->self == y->self)
+		return 0;
+	return x->self < y->self ? 1 : -1;
+}
+
+NO_INSTRUMENT static void __attribute__((destructor)) prof_report(void)
+{
+	prof_func *sorted[PROFILE_FUNCS];
+	const char *path;
+	Dl_info info;
+	FILE *fp;
+	int i, n = 0;
+
+	path = getenv("PM_PROFILE_FILE");
+	if (path == NULL)
+		path = DEFAULT_PROFILE_FILE;
+	fp = fopen(path, "w");
+	if (fp == NULL)
+		return;
+
+	for (i = 0; i < PROFILE_FUNCS; i++) {
+		if (prof_table[i].fn != NULL && prof_table[i].calls > 0)
+			sorted[n++] = &prof_table[i];
+	}
+	qsort(sorted, n, sizeof(sorted[0]), prof_cmp);
+
+	fprintf(fp, "%-32s %18s %12s %14s %14s %10s\n", "function", "offset",
+		"calls", "total(us)", "self(us)", "avg(ns)");
+	for (i = 0; i < n; i++) {
+		prof_func *f = sorted[i];
+		uintptr_t offset = (uintptr_t) f->fn;
+		const char *name = "?";
+
+		if (dladdr(f->fn, &info) != 0) {
+			offset -= (uintptr_t) info.dli_fbase;
+			if (info.dli_sname != NULL && info.dli_saddr == f->fn)
+				name = info.dli_sname;
+		}
+		fprintf(fp, "%-32s %#18lx %12llu %14llu %14llu %10llu\n", name,
+			(unsigned long)offset, f->calls, f->total / 1000,
+			f->self / 1000, f->self / f->calls);
+	}
+	if (prof_lost > 0)
+		fprintf(fp, "%u calls not recorded : function table full\n",
+			prof_lost);
+
+	fclose(fp);
+}
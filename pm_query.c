@@ -0,0 +1,298 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_query.c
+ * @version	0.1
+ * @brief	Power manager query socket
+ *
+ * The listening socket and the connected clients are watched in the
+ * pm_poll set. A client is answered when its command line is complete,
+ * so a slow client never blocks the main loop while it is writing.
+ * The reply is built in a memfd and sent as the client socket accepts
+ * it, so a client which does not read never blocks it either; it only
+ * holds up to QUERY_REPLY_MAX bytes until it goes.
+ */
+
+#define _GNU_SOURCE
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "util.h"
+#include "pm_core.h"
+#include "pm_poll.h"
+#include "pm_stats.h"
+#include "pm_hal.h"
+#include "pm_blenv.h"
+#include "pm_uevent.h"
+#include "pm_query.h"
+
+#define QUERY_CMD_MAX		32
+#define QUERY_REPLY_MAX		(256 * 1024)
+#define QUERY_CLIENTS_MAX	4
+
+typedef struct {
+	char cmd[QUERY_CMD_MAX];
+	int len;
+	pm_watch *watch;
+	char *out;		/* NULL : reading the command */
+	int out_len;
+	int out_sent;
+} query_client;
+
+typedef struct {
+	const char *name;
+	void (*print) (int fd);
+} query_cmd;
+
+static const query_cmd query_cmds[] = {
+	{"stats", pm_stats_print},
+	{"info", print_info},
+	{"log", pm_log_dump},
+	{"hal", pm_hal_print},
+	{"blenv", pm_blenv_print},
+	{"uevent", pm_uevent_print},
+};
+
+static int query_fd = -1;
+static pm_watch *query_watch;
+static int nr_clients;
+
+/* print the reply of cmd into cl->out */
+static int build_reply(query_client *cl, const char *cmd)
+{
+	char buf[64];
+	off_t size;
+	int fd, i, len;
+
+	/* the print functions write to a fd : an anonymous memory file */
+	fd = memfd_create("pm_query", MFD_CLOEXEC);
+	if (fd < 0) {
+		LOGERR("query memfd error : %s", strerror(errno));
+		return -1;
+	}
+
+	for (i = 0; i < sizeof(query_cmds) / sizeof(query_cmds[0]); i++) {
+		if (!strcmp(cmd, query_cmds[i].name)) {
+			query_cmds[i].print(fd);
+			break;
+		}
+	}
+	if (i == sizeof(query_cmds) / sizeof(query_cmds[0])) {
+		len = snprintf(buf, sizeof(buf), "unknown query : %s\n", cmd);
+		write(fd, buf, len);
+	}
+
+	size = lseek(fd, 0, SEEK_END);
+	if (size > QUERY_REPLY_MAX)
+		size = QUERY_REPLY_MAX;
+	cl->out = (char *)malloc(size > 0 ? size : 1);
+	if (cl->out == NULL
+	    || (size > 0 && pread(fd, cl->out, size, 0) != size)) {
+		close(fd);
+		return -1;
+	}
+	cl->out_len = size;
+	cl->out_sent = 0;
+	close(fd);
+
+	return 0;
+}
+
+static gboolean drop_client(int fd, query_client *cl)
+{
+	pm_poll_del_fd(cl->watch);
+	close(fd);
+	free(cl->out);
+	free(cl);
+	nr_clients--;
+	return FALSE;
+}
+
+/* @return 1 : the whole reply is sent or the client is gone */
+static int send_reply(int fd, query_client *cl)
+{
+	int n;
+
+	while (cl->out_sent < cl->out_len) {
+		n = send(fd, cl->out + cl->out_sent,
+			 cl->out_len - cl->out_sent, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && errno == EAGAIN)
+			return 0;
+		if (n <= 0)
+			return 1;
+		cl->out_sent += n;
+	}
+
+	return 1;
+}
+
+static gboolean query_client_handler(int fd, void *data)
+{
+	query_client *cl = (query_client *) data;
+	char *eol;
+	int n;
+
+	/* writable, or hung up */
+	if (cl->out != NULL)
+		return send_reply(fd, cl) ? drop_client(fd, cl) : TRUE;
+
+	n = read(fd, cl->cmd + cl->len, sizeof(cl->cmd) - 1 - cl->len);
+	if (n < 0 && (errno == EAGAIN || errno == EINTR))
+		return TRUE;
+	if (n > 0) {
+		cl->len += n;
+		cl->cmd[cl->len] = '\0';
+		eol = strpbrk(cl->cmd, "\r\n");
+		if (eol == NULL && cl->len < sizeof(cl->cmd) - 1)
+			return TRUE;
+		if (eol != NULL)
+			*eol = '\0';
+	}
+
+	/* complete command, or EOF after a command without newline */
+	if (cl->len == 0 || build_reply(cl, cl->cmd) < 0)
+		return drop_client(fd, cl);
+	if (send_reply(fd, cl) || pm_poll_set_output(cl->watch, 1) < 0)
+		return drop_client(fd, cl);
+
+	return TRUE;
+}
+
+static gboolean query_accept(int fd, void *data)
+{
+	query_client *cl;
+	int cfd;
+
+	cfd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (cfd < 0) {
+		if (errno != EAGAIN && errno != EINTR)
+			LOGERR("query accept error : %s", strerror(errno));
+		return TRUE;
+	}
+
+	if (nr_clients >= QUERY_CLIENTS_MAX) {
+		LOGERR("too many query clients");
+		close(cfd);
+		return TRUE;
+	}
+
+	cl = (query_client *) calloc(1, sizeof(query_client));
+	if (cl != NULL)
+		cl->watch = pm_poll_add_fd(cfd, query_client_handler, cl);
+	if (cl == NULL || cl->watch == NULL) {
+		free(cl);
+		close(cfd);
+		return TRUE;
+	}
+	nr_clients++;
+
+	return TRUE;
+}
+
+int init_pm_query(void)
+{
+	struct sockaddr_un addr;
+
+	query_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+			  0);
+	if (query_fd < 0) {
+		LOGERR("query socket error : %s", strerror(errno));
+		return -1;
+	}
+
+	unlink(runtime_path(QUERY_SOCK_PATH));
+	memset(&addr, 0x0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, runtime_path(QUERY_SOCK_PATH), sizeof(addr.sun_path) - 1);
+
+	if (bind(query_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+	    || listen(query_fd, 4) < 0) {
+		LOGERR("query socket bind error : %s", strerror(errno));
+		close(query_fd);
+		query_fd = -1;
+		return -1;
+	}
+	/* the replies show the lock owners, for root only */
+	if (chmod(runtime_path(QUERY_SOCK_PATH), 0600) < 0)
+		LOGERR("failed to change the query socket permission");
+
+	query_watch = pm_poll_add_fd(query_fd, query_accept, NULL);
+	if (query_watch == NULL) {
+		exit_pm_query();
+		return -1;
+	}
+
+	return 0;
+}
+
+int exit_pm_query(void)
+{
+	if (query_fd < 0)
+		return 0;
+
+	pm_poll_del_fd(query_watch);
+	query_watch = NULL;
+	close(query_fd);
+	query_fd = -1;
+	unlink(runtime_path(QUERY_SOCK_PATH));
+
+	return 0;
+}
+
+int pm_query(const char *cmd, int out_fd)
+{
+	struct sockaddr_un addr;
+	char buf[1024];
+	int fd, n;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+
+	memset(&addr, 0x0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, runtime_path(QUERY_SOCK_PATH), sizeof(addr.sun_path) - 1);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	n = snprintf(buf, sizeof(buf), "%s\n", cmd);
+	if (write(fd, buf, n) != n) {
+		close(fd);
+		return -1;
+	}
+
+	while ((n = read(fd, buf, sizeof(buf))) > 0)
+		write(out_fd, buf, n);
+
+	close(fd);
+	return n < 0 ? -1 : 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_query.h
+ * @version	0.1
+ * @brief	Power manager query socket
+ *
+ * A client connects to QUERY_SOCK_PATH, writes one command line and
+ * reads the text reply until the daemon closes the connection.
+ * Commands : "stats", "info", "log", "hal", "blenv", "uevent"
+ */
+#ifndef __PM_QUERY_H__
+#define __PM_QUERY_H__
+
+/**
+ * @addtogroup POWER_MANAGER
+ * @{
+ */
+
+#define QUERY_SOCK_PATH		"/tmp/pm_query"
+
+/* daemon side, the socket is watched in the pm_poll set */
+extern int init_pm_query(void);
+extern int exit_pm_query(void);
+
+/*
+ * client side : send cmd and copy the reply to out_fd
+ *
+ * @return 0 : success, -1 : error
+ */
+extern int pm_query(const char *cmd, int out_fd);
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,311 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_replay.c
+ * @version	0.1
+ * @brief	Replay a PM_RECORD file against the power manager state machine
+ *
+ * usage : pm_replay [-q] <record file>
+ *
+ * The daemon main loop runs with no input device, with the memory
+ * settings backend and with the stand-in backends of pm_replay_stubs.c,
+ * so no device hardware is needed.
+ * One record is fed per main loop iteration:
+ *  input batches are written to a pipe and read by pm_handler(),
+ *  control messages go to the poll callback,
+ *  timer firings call the state timeout handler or expire the lock.
+ * Every recorded pid is mapped to a child process, which lives until
+ * the owner exit of that pid is replayed.
+ * The CPU time of each record and the state transitions are printed,
+ * and the state machine metrics at the end.
+ */
+
+#define _GNU_SOURCE
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+
+#include "util.h"
+#include "pm_core.h"
+#include "pm_poll.h"
+#include "pm_stats.h"
+
+static const char *replay_state_name[S_END] =
+    { "S_START", "S_NORMAL", "S_LCDDIM", "S_LCDOFF", "S_SLEEP" };
+
+static const char *replay_type_name[] =
+    { "-", "input", "msg", "timeout", "lock_timeout", "owner_exit" };
+
+#define REPLAY_TYPES	(sizeof(replay_type_name) / sizeof(replay_type_name[0]))
+
+typedef struct {
+	unsigned int count;
+	long long cpu;		/* ns */
+	long long max;		/* ns */
+} replay_stat;
+
+static gchar *rec_buf;
+static gsize rec_size;
+static gsize rec_off;
+static long long rec_start = -1;
+static int quiet;
+static int input_pipe[2];
+static indev replay_dev = { .dev_path = "replay", .dev_fd = -1,
+	.dev_watch = { .fd = -1 } };
+static GHashTable *owners;	/* recorded pid -> stand-in child pid */
+static replay_stat stats[REPLAY_TYPES];
+static unsigned int records;
+static unsigned int transitions;
+
+static long long cpu_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* a recorded lock owner is alive until its exit is replayed */
+static pid_t map_pid(pid_t pid)
+{
+	pid_t child;
+
+	if (pid <= 0)
+		return pid;
+
+	child = GPOINTER_TO_INT(g_hash_table_lookup(owners,
+				GINT_TO_POINTER(pid)));
+	if (child > 0)
+		return child;
+
+	child = fork();
+	if (child == 0) {
+		prctl(PR_SET_PDEATHSIG, SIGKILL);
+		for (;;)
+			pause();
+	}
+	if (child < 0) {
+		perror("fork");
+		return pid;
+	}
+	g_hash_table_insert(owners, GINT_TO_POINTER(pid),
+			    GINT_TO_POINTER(child));
+	return child;
+}
+
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open		434
+#endif
+
+/* kill a stand-in owner and wait until its pidfd reports the exit */
+static void owner_exit(pid_t pid)
+{
+	struct pollfd pfd;
+	pid_t child;
+
+	child = GPOINTER_TO_INT(g_hash_table_lookup(owners,
+				GINT_TO_POINTER(pid)));
+	if (child <= 0)
+		return;
+	g_hash_table_remove(owners, GINT_TO_POINTER(pid));
+
+	pfd.fd = syscall(__NR_pidfd_open, child, 0);
+	pfd.events = POLLIN;
+	kill(child, SIGKILL);
+	if (pfd.fd >= 0) {
+		poll(&pfd, 1, -1);
+		close(pfd.fd);
+	}
+}
+
+static void kill_owner(gpointer key, gpointer value, gpointer data)
+{
+	kill(GPOINTER_TO_INT(value), SIGKILL);
+}
+
+static void replay_report(void)
+{
+	int i;
+
+	printf("\n%u records, %u state transitions\n", records, transitions);
+	printf("%-13s %8s %14s %10s %10s\n", "record", "count",
+	       "cpu total(us)", "avg(us)", "max(us)");
+	for (i = 1; i < REPLAY_TYPES; i++) {
+		if (stats[i].count == 0)
+			continue;
+		printf("%-13s %8u %14lld %10lld %10lld\n", replay_type_name[i],
+		       stats[i].count, stats[i].cpu / 1000,
+		       stats[i].cpu / 1000 / stats[i].count,
+		       stats[i].max / 1000);
+	}
+	printf("\n");
+	fflush(stdout);
+	pm_stats_print(STDOUT_FILENO);
+}
+
+static void replay_finish(void)
+{
+	replay_report();
+	g_hash_table_foreach(owners, kill_owner, NULL);
+	/* sig_quit() stops the main loop */
+	raise(SIGTERM);
+}
+
+static gboolean replay_step(gpointer data)
+{
+	pm_rec_hdr hdr;
+	pm_rec_lock lock;
+	PMMsg msg;
+	char *payload;
+	int before = cur_state;
+	long long start, elapsed;
+
+	if (rec_off + sizeof(hdr) > rec_size) {
+		replay_finish();
+		return FALSE;
+	}
+	memcpy(&hdr, rec_buf + rec_off, sizeof(hdr));
+	if (rec_off + sizeof(hdr) + hdr.len > rec_size
+	    || hdr.type == 0 || hdr.type >= REPLAY_TYPES) {
+		fprintf(stderr, "broken record at offset %lu\n",
+			(unsigned long)rec_off);
+		replay_finish();
+		return FALSE;
+	}
+	payload = rec_buf + rec_off + sizeof(hdr);
+	rec_off += sizeof(hdr) + hdr.len;
+	if (rec_start < 0)
+		rec_start = hdr.time;
+
+	if (hdr.type == PM_REC_INPUT
+	    && write(input_pipe[1], payload, hdr.len) != hdr.len) {
+		fprintf(stderr, "input batch of %u bytes is dropped\n", hdr.len);
+		return TRUE;
+	}
+
+	start = cpu_now();
+	switch (hdr.type) {
+	case PM_REC_INPUT:
+		pm_handler(input_pipe[0], &replay_dev);
+		break;
+	case PM_REC_MSG:
+		memcpy(&msg, payload, sizeof(msg));
+		msg.pid = map_pid(msg.pid);
+		(*g_pm_callback) (PM_CONTROL_EVENT, &msg);
+		break;
+	case PM_REC_TIMEOUT:
+		timeout_handler(NULL);
+		break;
+	case PM_REC_LOCK_TIMEOUT:
+		memcpy(&lock, payload, sizeof(lock));
+		pm_expire_lock(map_pid(lock.pid), lock.state);
+		break;
+	case PM_REC_OWNER_EXIT:
+		/* the pidfd watch of the lock releases it */
+		memcpy(&lock, payload, sizeof(lock));
+		owner_exit(lock.pid);
+		break;
+	}
+	elapsed = cpu_now() - start;
+
+	records++;
+	stats[hdr.type].count++;
+	stats[hdr.type].cpu += elapsed;
+	if (elapsed > stats[hdr.type].max)
+		stats[hdr.type].max = elapsed;
+	if (cur_state != before)
+		transitions++;
+
+	if (!quiet)
+		printf("%8lld.%03lld %-13s cpu %7lld us  %s%s%s\n",
+		       (hdr.time - rec_start) / 1000000,
+		       (hdr.time - rec_start) / 1000 % 1000,
+		       replay_type_name[hdr.type], elapsed / 1000,
+		       cur_state != before ? replay_state_name[before] : "",
+		       cur_state != before ? " -> " : "",
+		       cur_state != before ? replay_state_name[cur_state] : "");
+
+	return TRUE;
+}
+
+int main(int argc, char *argv[])
+{
+	pm_rec_file_hdr hdr;
+	GError *err = NULL;
+	int c;
+
+	while ((c = getopt(argc, argv, "q")) != -1) {
+		switch (c) {
+		case 'q':
+			quiet = 1;
+			break;
+		default:
+			fprintf(stderr, "usage : %s [-q] <record file>\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (optind + 1 != argc) {
+		fprintf(stderr, "usage : %s [-q] <record file>\n", argv[0]);
+		return 1;
+	}
+
+	if (!g_file_get_contents(argv[optind], &rec_buf, &rec_size, &err)) {
+		fprintf(stderr, "%s\n", err->message);
+		g_error_free(err);
+		return 1;
+	}
+	if (rec_size >= sizeof(hdr))
+		memcpy(&hdr, rec_buf, sizeof(hdr));
+	if (rec_size < sizeof(hdr) || hdr.magic != PM_REC_MAGIC
+	    || hdr.version != PM_REC_VERSION) {
+		fprintf(stderr, "%s is not a record file\n", argv[optind]);
+		return 1;
+	}
+	rec_off = sizeof(hdr);
+
+	if (pipe2(input_pipe, O_NONBLOCK | O_CLOEXEC) < 0) {
+		perror("pipe");
+		return 1;
+	}
+	replay_dev.dev_fd = input_pipe[0];
+	owners = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	/* no input device, no recording of the replay itself */
+	setenv("PM_INPUT", "", 1);
+	unsetenv("PM_RECORD");
+	setenv("PM_SETTINGS_BACKEND", "memory", 1);
+	/* no live hotplug, nothing sends to this socket */
+	setenv("PM_UEVENT_SOCKET", runtime_path("/tmp/pm_replay_uevent"), 1);
+	/* the lock screen is ready, do not wait for it on LCD on */
+	setting_set_int(VCONFKEY_IDLE_LOCK_STATE, VCONFKEY_IDLE_LOCK);
+
+	/* below the poll source, so the watches run between the records */
+	g_idle_add_full(G_PRIORITY_LOW + 1, replay_step, NULL, NULL);
+	start_main(WITHOUT_STARTNOTI);
+
+	return records > 0 ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_replay_stubs.c
+ * @version	0.1
+ * @brief	Stand-in platform backends of pm_replay
+ *
+ * pm_replay is linked with these instead of heynoti, sysman, the
+ * sensor framework and the device manager plugin, so it runs on a
+ * plain Linux box. The settings are kept by the memory backend.
+ * The device manager plugin accepts every request and keeps the
+ * brightness. The platform headers come from replay/, so only glib
+ * has to be installed.
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <heynoti.h>
+#include <sysman.h>
+#include <sensor.h>
+
+#include "pm_device_plugin.h"
+
+/* heynoti */
+
+int heynoti_publish(const char *noti)
+{
+	return 0;
+}
+
+/* sysman */
+
+int sysman_inform_active(pid_t pid)
+{
+	return 0;
+}
+
+int sysman_inform_inactive(pid_t pid)
+{
+	return 0;
+}
+
+int sysman_call_predef_action(const char *type, int num, ...)
+{
+	return 0;
+}
+
+/* sensor framework : there is no light sensor */
+
+int sf_connect(sensor_type_t sensor_type)
+{
+	return -1;
+}
+
+int sf_disconnect(int handle)
+{
+	return 0;
+}
+
+int sf_start(int handle, int option)
+{
+	return -1;
+}
+
+int sf_stop(int handle)
+{
+	return 0;
+}
+
+int sf_get_data(int handle, unsigned int data_id, sensor_data_t *values)
+{
+	return -1;
+}
+
+/* device manager plugin */
+
+#define STUB_MAX_BRT	100
+
+static int stub_brt = STUB_MAX_BRT;
+static int stub_wakeup_count;
+
+static int stub_get_max_brt(int index, int *value)
+{
+	*value = STUB_MAX_BRT;
+	return 0;
+}
+
+static int stub_get_min_brt(int index, int *value)
+{
+	*value = 1;
+	return 0;
+}
+
+static int stub_get_brt(int index, int *value, int pmstate)
+{
+	*value = stub_brt;
+	return 0;
+}
+
+static int stub_set_brt(int index, int value, int pmstate)
+{
+	stub_brt = value;
+	return 0;
+}
+
+static int stub_set_dimming(int index, int value)
+{
+	return 0;
+}
+
+static int stub_set_lcd_power(int index, int value)
+{
+	return 0;
+}
+
+static int stub_set_frame_rate(int value)
+{
+	return 0;
+}
+
+static int stub_get_wakeup_count(int *value)
+{
+	*value = stub_wakeup_count;
+	return 0;
+}
+
+static int stub_set_wakeup_count(int value)
+{
+	return 0;
+}
+
+static int stub_set_power_state(int value)
+{
+	/* a suspend returns at once, as if woken up by a device */
+	stub_wakeup_count++;
+	return 0;
+}
+
+static const OEM_sys_devman_plugin_interface stub_plugin = {
+	.OEM_sys_get_backlight_max_brightness = stub_get_max_brt,
+	.OEM_sys_get_backlight_min_brightness = stub_get_min_brt,
+	.OEM_sys_get_backlight_brightness = stub_get_brt,
+	.OEM_sys_set_backlight_brightness = stub_set_brt,
+	.OEM_sys_set_backlight_dimming = stub_set_dimming,
+	.OEM_sys_set_lcd_power = stub_set_lcd_power,
+	.OEM_sys_set_display_frame_rate = stub_set_frame_rate,
+	.OEM_sys_get_power_wakeup_count = stub_get_wakeup_count,
+	.OEM_sys_set_power_wakeup_count = stub_set_wakeup_count,
+	.OEM_sys_set_power_state = stub_set_power_state,
+};
+
+int _pm_devman_plugin_init(void)
+{
+	plugin_intf = &stub_plugin;
+	return 0;
+}
+
+int _pm_devman_plugin_fini(void)
+{
+	return 0;
+}
@@ -17,6 +17,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "pm_setting.h"
 #include "pm_conf.h"
 #include "util.h"
@@ -31,31 +32,93 @@ static const char *setting_keys[SETTING_GET_END] = {
 	[SETTING_POWER_SAVING_DISPLAY] = VCONFKEY_SETAPPL_PWRSV_CUSTMODE_DISPLAY,
 };
 
+static const setting_backend *backends[] = {
+#ifdef ENABLE_VCONF_SETTING
+	&vconf_setting_backend,
+#endif
+	&mem_setting_backend,
+};
+
+static const setting_backend *backend;
+pm_policy policy = { -1, -1, -1, 0 };
 static int (*update_setting) (int key_idx, int val);
 
+static const setting_backend *get_backend(void)
+{
+	char *name;
+	int i;
+
+	if (backend != NULL)
+		return backend;
+
+	backend = backends[0];
+	name = getenv("PM_SETTINGS_BACKEND");
+	if (name == NULL || name[0] == '\0')
+		return backend;
+
+	for (i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+		if (!strcmp(backends[i]->name, name)) {
+			backend = backends[i];
+			break;
+		}
+	}
+	if (strcmp(backend->name, name))
+		LOGERR("unknown settings backend %s, use %s", name,
+		       backend->name);
+	else
+		LOGINFO("settings backend : %s", name);
+
+	return backend;
+}
+
+int setting_get_int(const char *key, int *val)
+{
+	return get_backend()->get_int(key, val);
+}
+
+int setting_get_bool(const char *key, int *val)
+{
+	return get_backend()->get_bool(key, val);
+}
+
+int setting_set_int(const char *key, int val)
+{
+	return get_backend()->set_int(key, val);
+}
+
+int setting_notify_key(const char *key, setting_cb_fn cb, void *data)
+{
+	return get_backend()->notify(key, cb, data);
+}
+
+int setting_ignore_key(const char *key, setting_cb_fn cb)
+{
+	return get_backend()->ignore(key, cb);
+}
+
 int get_charging_status(int *val)
 {
-	return vconf_get_int(VCONFKEY_SYSMAN_BATTERY_CHARGE_NOW, val);
+	return setting_get_int(VCONFKEY_SYSMAN_BATTERY_CHARGE_NOW, val);
 }
 
 int get_lowbatt_status(int *val)
 {
-	return vconf_get_int(VCONFKEY_SYSMAN_BATTERY_STATUS_LOW, val);
+	return setting_get_int(VCONFKEY_SYSMAN_BATTERY_STATUS_LOW, val);
 }
 
 int get_usb_status(int *val)
 {
-	return vconf_get_int(VCONFKEY_SYSMAN_USB_STATUS, val);
+	return setting_get_int(VCONFKEY_SYSMAN_USB_STATUS, val);
 }
 
 int set_setting_pmstate(int val)
 {
-	return vconf_set_int(VCONFKEY_PM_STATE, val);
+	return setting_set_int(VCONFKEY_PM_STATE, val);
 }
 
 int get_setting_brightness(int *level)
 {
-	return vconf_get_int(VCONFKEY_SETAPPL_LCD_BRIGHTNESS, level);
+	return setting_get_int(VCONFKEY_SETAPPL_LCD_BRIGHTNESS, level);
 }
 
 int get_run_timeout(int *timeout)
@@ -68,7 +131,7 @@ int get_run_timeout(int *timeout)
 		dim_timeout = 5;
 	}
 
-	ret = vconf_get_int(setting_keys[SETTING_TO_NORMAL], &vconf_timeout);
+	ret = setting_get_int(setting_keys[SETTING_TO_NORMAL], &vconf_timeout);
 
 	if(vconf_timeout == 0)
 		*timeout = 0; //timeout 0 : Always ON (Do not apply dim_timeout)
@@ -100,35 +163,53 @@ int get_off_timeout(int *timeout)
 	return 0;
 }
 
-static int setting_cb(keynode_t *key_nodes, void *data)
+static void update_policy(int key_idx, int val)
 {
-	keynode_t *tmp = key_nodes;
+	switch (key_idx) {
+	case SETTING_LOCK_SCREEN:
+		policy.lock_state = val;
+		break;
+	case SETTING_POWER_SAVING:
+		policy.power_saving = val;
+		break;
+	case SETTING_POWER_SAVING_DISPLAY:
+		policy.power_saving_display = val;
+		break;
+	default:
+		return;
+	}
+	policy.display_saving =
+	    (policy.power_saving == 1 && policy.power_saving_display == 1);
+}
 
+static void setting_cb(const char *key, int val, void *data)
+{
 	if ((int)data > SETTING_END) {
-		LOGERR("Unknown setting key: %s, idx= %d",
-		       vconf_keynode_get_name, (int)data);
-		return -1;
-	}
-	if (update_setting != NULL) {
-		if ((int)data >= SETTING_POWER_SAVING)
-			update_setting((int)data, vconf_keynode_get_bool(tmp));
-		else
-			update_setting((int)data, vconf_keynode_get_int(tmp));
+		LOGERR("Unknown setting key: %s, idx= %d", key, (int)data);
+		return;
 	}
-
-	return 0;
+	update_policy((int)data, val);
+	if (update_setting != NULL)
+		update_setting((int)data, val);
 }
 
 int init_setting(int (*func) (int key_idx, int val))
 {
-	int i;
+	int i, val;
 
 	if (func != NULL)
 		update_setting = func;
 
+	if (setting_get_int(setting_keys[SETTING_LOCK_SCREEN], &val) == 0)
+		update_policy(SETTING_LOCK_SCREEN, val);
+	if (setting_get_bool(setting_keys[SETTING_POWER_SAVING], &val) == 0)
+		update_policy(SETTING_POWER_SAVING, val);
+	if (setting_get_bool(setting_keys[SETTING_POWER_SAVING_DISPLAY],
+			     &val) == 0)
+		update_policy(SETTING_POWER_SAVING_DISPLAY, val);
+
 	for (i = SETTING_BEGIN; i < SETTING_GET_END; i++) {
-		vconf_notify_key_changed(setting_keys[i], (void *)setting_cb,
-					 (void *)i);
+		setting_notify_key(setting_keys[i], setting_cb, (void *)i);
 	}
 
 	return 0;
@@ -138,7 +219,7 @@ int exit_setting()
 {
 	int i;
 	for (i = SETTING_BEGIN; i < SETTING_GET_END; i++) {
-		vconf_ignore_key_changed(setting_keys[i], (void *)setting_cb);
+		setting_ignore_key(setting_keys[i], setting_cb);
 	}
 
 	return 0;
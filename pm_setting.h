@@ -23,7 +23,7 @@
 #ifndef __PM_SETTING_H__
 #define __PM_SETTING_H__
 
-#include <vconf.h>
+#include <vconf-keys.h>
 
 /*
  * @addtogroup POWER_MANAGER
@@ -44,6 +44,58 @@ enum {
 	SETTING_END
 };
 
+/*
+ * Settings backend
+ *
+ * The daemon reads and writes its settings through one backend,
+ * selected by PM_SETTINGS_BACKEND at the first use :
+ *  "vconf"  : the platform settings (default)
+ *  "memory" : an in-process key/value store, see pm_setting_mem.c
+ * Key names are the vconf key names for every backend.
+ * A change callback gets the new value, as int for both int and bool.
+ */
+typedef void (*setting_cb_fn) (const char *key, int val, void *data);
+
+typedef struct {
+	const char *name;
+	int (*get_int) (const char *key, int *val);
+	int (*get_bool) (const char *key, int *val);
+	int (*set_int) (const char *key, int val);
+	int (*notify) (const char *key, setting_cb_fn cb, void *data);
+	int (*ignore) (const char *key, setting_cb_fn cb);
+} setting_backend;
+
+#ifdef ENABLE_VCONF_SETTING
+extern const setting_backend vconf_setting_backend;
+#endif
+extern const setting_backend mem_setting_backend;
+
+/*
+ * backend accessors, same return values as the vconf functions
+ */
+extern int setting_get_int(const char *key, int *val);
+extern int setting_get_bool(const char *key, int *val);
+extern int setting_set_int(const char *key, int val);
+extern int setting_notify_key(const char *key, setting_cb_fn cb, void *data);
+extern int setting_ignore_key(const char *key, setting_cb_fn cb);
+
+/*
+ * Policy snapshot
+ *
+ * Values of the watched keys the hot paths depend on. init_setting()
+ * reads them once and the change notifications keep them up to date,
+ * before the configuration change callback runs. A key which cannot
+ * be read is -1.
+ */
+typedef struct {
+	int lock_state;		/* VCONFKEY_IDLE_LOCK_STATE */
+	int power_saving;	/* power saving mode */
+	int power_saving_display;	/* display saving of the custom mode */
+	int display_saving;	/* 1 if both of the above are on, else 0 */
+} pm_policy;
+
+extern pm_policy policy;
+
 extern int get_setting_brightness();
 
 /*
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_setting_mem.c
+ * @version	0.1
+ * @brief	In-process settings backend
+ *
+ * Used with PM_SETTINGS_BACKEND=memory to run the daemon without vconf.
+ * The keys start with the values of a fresh device below, and then
+ * the values of PM_SETTINGS_FILE if it is set, one "<key> <value>"
+ * per line. A key which is neither there fails to read, like a missing
+ * vconf key. Changes are notified from the main loop like vconf does,
+ * also to the process which made them; setting the same value again is
+ * not a change.
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "pm_setting.h"
+#include "util.h"
+
+typedef struct {
+	char *key;
+	setting_cb_fn cb;
+	void *data;
+	int removed;		/* ignored during a dispatch, freed after it */
+} mem_watch;
+
+typedef struct {
+	char *key;
+	int val;
+} mem_change;
+
+static const struct {
+	const char *key;
+	int val;
+} mem_defaults[] = {
+	{ VCONFKEY_SETAPPL_LCD_TIMEOUT_NORMAL, 30 },
+	{ VCONFKEY_SYSMAN_BATTERY_STATUS_LOW, VCONFKEY_SYSMAN_BAT_NORMAL },
+	{ VCONFKEY_SYSMAN_BATTERY_CHARGE_NOW, 0 },
+	{ VCONFKEY_SYSMAN_USB_STATUS, 0 },
+	{ VCONFKEY_IDLE_LOCK_STATE, VCONFKEY_IDLE_UNLOCK },
+	{ VCONFKEY_SETAPPL_PWRSV_SYSMODE_STATUS, 0 },
+	{ VCONFKEY_SETAPPL_PWRSV_CUSTMODE_DISPLAY, 0 },
+	{ VCONFKEY_SETAPPL_BRIGHTNESS_AUTOMATIC_INT,
+	  SETTING_BRIGHTNESS_AUTOMATIC_OFF },
+	{ VCONFKEY_TESTMODE_POWER_OFF_POPUP, 0 },
+	{ VCONFKEY_FLASHPLAYER_FULLSCREEN, 0 },
+};
+
+static GHashTable *mem_keys;
+static GSList *watches;
+static int dispatching;
+
+static void load_settings_file(const char *path)
+{
+	char line[PATH_MAX];
+	char key[PATH_MAX];
+	int val;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		LOGERR("cannot open %s", path);
+		return;
+	}
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (line[0] == '#')
+			continue;
+		if (sscanf(line, "%s %d", key, &val) != 2)
+			continue;
+		g_hash_table_replace(mem_keys, g_strdup(key),
+				     GINT_TO_POINTER(val));
+	}
+	fclose(fp);
+}
+
+static GHashTable *get_keys(void)
+{
+	char *path;
+	int i;
+
+	if (mem_keys != NULL)
+		return mem_keys;
+
+	mem_keys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	for (i = 0; i < sizeof(mem_defaults) / sizeof(mem_defaults[0]); i++)
+		g_hash_table_replace(mem_keys, g_strdup(mem_defaults[i].key),
+				     GINT_TO_POINTER(mem_defaults[i].val));
+
+	path = getenv("PM_SETTINGS_FILE");
+	if (path != NULL && path[0] != '\0')
+		load_settings_file(path);
+
+	return mem_keys;
+}
+
+static int mem_get_int(const char *key, int *val)
+{
+	gpointer v;
+
+	if (!g_hash_table_lookup_extended(get_keys(), key, NULL, &v))
+		return -1;
+	*val = GPOINTER_TO_INT(v);
+
+	return 0;
+}
+
+static void free_watch(mem_watch *w)
+{
+	g_free(w->key);
+	g_free(w);
+}
+
+static gboolean dispatch_change(gpointer data)
+{
+	mem_change *ch = (mem_change *) data;
+	GSList *l, *next;
+
+	/*
+	 * a callback may ignore any watch, itself or the next one, so the
+	 * links stay in the list until the end of the dispatch
+	 */
+	dispatching++;
+	for (l = watches; l != NULL; l = l->next) {
+		mem_watch *w = (mem_watch *) l->data;
+
+		if (!w->removed && !strcmp(w->key, ch->key))
+			w->cb(w->key, ch->val, w->data);
+	}
+	dispatching--;
+
+	for (l = watches; l != NULL && dispatching == 0; l = next) {
+		mem_watch *w = (mem_watch *) l->data;
+
+		next = l->next;
+		if (w->removed) {
+			watches = g_slist_delete_link(watches, l);
+			free_watch(w);
+		}
+	}
+	g_free(ch->key);
+	g_free(ch);
+
+	return FALSE;
+}
+
+static int mem_set_int(const char *key, int val)
+{
+	mem_change *ch;
+	int old;
+
+	if (mem_get_int(key, &old) == 0 && old == val)
+		return 0;
+	g_hash_table_replace(get_keys(), g_strdup(key), GINT_TO_POINTER(val));
+
+	ch = g_new0(mem_change, 1);
+	ch->key = g_strdup(key);
+	ch->val = val;
+	g_idle_add(dispatch_change, ch);
+
+	return 0;
+}
+
+static int mem_notify(const char *key, setting_cb_fn cb, void *data)
+{
+	mem_watch *w;
+
+	w = g_new0(mem_watch, 1);
+	w->key = g_strdup(key);
+	w->cb = cb;
+	w->data = data;
+	watches = g_slist_append(watches, w);
+
+	return 0;
+}
+
+static int mem_ignore(const char *key, setting_cb_fn cb)
+{
+	GSList *l;
+
+	for (l = watches; l != NULL; l = l->next) {
+		mem_watch *w = (mem_watch *) l->data;
+
+		if (w->removed || w->cb != cb || strcmp(w->key, key))
+			continue;
+		if (dispatching) {
+			w->removed = 1;
+		} else {
+			watches = g_slist_delete_link(watches, l);
+			free_watch(w);
+		}
+		break;
+	}
+
+	return 0;
+}
+
+const setting_backend mem_setting_backend = {
+	.name = "memory",
+	.get_int = mem_get_int,
+	.get_bool = mem_get_int,
+	.set_int = mem_set_int,
+	.notify = mem_notify,
+	.ignore = mem_ignore,
+};
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_setting_vconf.c
+ * @version	0.1
+ * @brief	vconf settings backend
+ */
+
+#include <glib.h>
+#include <string.h>
+#include <vconf.h>
+
+#include "pm_setting.h"
+#include "util.h"
+
+typedef struct {
+	char *key;
+	setting_cb_fn cb;
+	void *data;
+} vconf_watch;
+
+static GSList *watches;
+
+static int vconf_backend_get_int(const char *key, int *val)
+{
+	return vconf_get_int(key, val);
+}
+
+static int vconf_backend_get_bool(const char *key, int *val)
+{
+	return vconf_get_bool(key, val);
+}
+
+static int vconf_backend_set_int(const char *key, int val)
+{
+	return vconf_set_int(key, val);
+}
+
+static void vconf_changed(keynode_t *node, void *data)
+{
+	vconf_watch *w = (vconf_watch *) data;
+	int val;
+
+	if (vconf_keynode_get_type(node) == VCONF_TYPE_BOOL)
+		val = vconf_keynode_get_bool(node);
+	else
+		val = vconf_keynode_get_int(node);
+
+	w->cb(w->key, val, w->data);
+}
+
+static int vconf_backend_notify(const char *key, setting_cb_fn cb, void *data)
+{
+	vconf_watch *w;
+
+	w = g_new0(vconf_watch, 1);
+	w->key = g_strdup(key);
+	w->cb = cb;
+	w->data = data;
+
+	if (vconf_notify_key_changed(key, vconf_changed, w) < 0) {
+		LOGERR("cannot watch %s", key);
+		g_free(w->key);
+		g_free(w);
+		return -1;
+	}
+	watches = g_slist_prepend(watches, w);
+
+	return 0;
+}
+
+static int vconf_backend_ignore(const char *key, setting_cb_fn cb)
+{
+	vconf_watch *found = NULL;
+	GSList *l;
+
+	for (l = watches; l != NULL; l = l->next) {
+		vconf_watch *w = (vconf_watch *) l->data;
+
+		if (w->cb == cb && !strcmp(w->key, key)) {
+			found = w;
+			watches = g_slist_delete_link(watches, l);
+			break;
+		}
+	}
+	if (found == NULL)
+		return 0;
+
+	/* this drops every watch of the key, put back the others */
+	vconf_ignore_key_changed(key, vconf_changed);
+	for (l = watches; l != NULL; l = l->next) {
+		vconf_watch *w = (vconf_watch *) l->data;
+
+		if (!strcmp(w->key, key))
+			vconf_notify_key_changed(key, vconf_changed, w);
+	}
+	g_free(found->key);
+	g_free(found);
+
+	return 0;
+}
+
+const setting_backend vconf_setting_backend = {
+	.name = "vconf",
+	.get_int = vconf_backend_get_int,
+	.get_bool = vconf_backend_get_bool,
+	.set_int = vconf_backend_set_int,
+	.notify = vconf_backend_notify,
+	.ignore = vconf_backend_ignore,
+};
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_shm.c
+ * @version	0.1
+ * @brief	Power manager shared state page (writer side)
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "util.h"
+#include "pm_shm.h"
+
+static pm_state_page *page;
+static size_t page_size;
+
+int init_pm_shm(void)
+{
+	int fd;
+	void *addr;
+
+	page_size = getpagesize();
+	if (page_size < sizeof(pm_state_page))
+		page_size = sizeof(pm_state_page);
+
+	unlink(runtime_path(SHM_PATH));
+	fd = open(runtime_path(SHM_PATH), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		LOGERR("state page open error : %s", strerror(errno));
+		return -1;
+	}
+	/* clients must be able to read it regardless of umask */
+	fchmod(fd, 0644);
+
+	if (ftruncate(fd, page_size) < 0) {
+		LOGERR("state page truncate error : %s", strerror(errno));
+		close(fd);
+		unlink(runtime_path(SHM_PATH));
+		return -1;
+	}
+
+	addr = mmap(NULL, page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		LOGERR("state page mmap error : %s", strerror(errno));
+		unlink(runtime_path(SHM_PATH));
+		return -1;
+	}
+
+	page = (pm_state_page *) addr;
+	page->version = PM_SHM_VERSION;
+	__sync_synchronize();
+	page->magic = PM_SHM_MAGIC;
+
+	LOGINFO("state page published at %s", runtime_path(SHM_PATH));
+	return 0;
+}
+
+int exit_pm_shm(void)
+{
+	if (page == NULL)
+		return 0;
+
+	page->magic = 0;
+	munmap(page, page_size);
+	page = NULL;
+	unlink(runtime_path(SHM_PATH));
+
+	return 0;
+}
+
+void pm_shm_publish(int state, int cond, const int *timeout,
+		    long long deadline)
+{
+	int i;
+
+	if (page == NULL)
+		return;
+
+	page->seq++;
+	__sync_synchronize();
+
+	page->cur_state = state;
+	page->trans_condition = cond;
+	for (i = 0; i < PM_SHM_STATES; i++)
+		page->timeout[i] = timeout[i];
+	page->deadline = deadline;
+
+	__sync_synchronize();
+	page->seq++;
+}
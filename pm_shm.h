@@ -0,0 +1,48 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_shm.h
+ * @version	0.1
+ * @brief	Power manager shared state page
+ *
+ * The daemon side of the state page, the layout and the reader for
+ * the clients are in pm_state.h.
+ */
+#ifndef __PM_SHM_H__
+#define __PM_SHM_H__
+
+#include "pm_state.h"
+
+/**
+ * @addtogroup POWER_MANAGER
+ * @{
+ */
+
+#define SHM_PATH		PM_SHM_PATH
+
+/* daemon side */
+extern int init_pm_shm(void);
+extern int exit_pm_shm(void);
+extern void pm_shm_publish(int state, int cond, const int *timeout,
+			   long long deadline);
+
+/**
+ * @}
+ */
+
+#endif				/*__PM_SHM_H__ */
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_state.h
+ * @version	0.1
+ * @brief	Power manager shared state page, client side
+ *
+ * The daemon publishes its state in a page of PM_SHM_PATH. Clients map
+ * the file read-only and read the state with pm_shm_read() without any
+ * IPC round trip. The page is protected by a sequence lock : seq is odd
+ * while the daemon is updating the page. This header is installed as
+ * <power-manager/pm_state.h> and needs no library.
+ */
+#ifndef __PM_STATE_H__
+#define __PM_STATE_H__
+
+/**
+ * @addtogroup POWER_MANAGER
+ * @{
+ */
+
+#define PM_SHM_PATH		"/tmp/pm_state"
+#define PM_SHM_MAGIC		0x504d5350	/* "PMSP" */
+#define PM_SHM_VERSION		1
+#define PM_SHM_STATES		5	/* S_START ~ S_SLEEP */
+
+/* cur_state values, the index of timeout[] */
+#define PM_SHM_S_START		0
+#define PM_SHM_S_NORMAL		1
+#define PM_SHM_S_LCDDIM		2
+#define PM_SHM_S_LCDOFF		3
+#define PM_SHM_S_SLEEP		4
+
+typedef struct {
+	unsigned int magic;
+	unsigned int version;
+	volatile unsigned int seq;
+	int cur_state;
+	int trans_condition;
+	int timeout[PM_SHM_STATES];	/* seconds */
+	long long deadline;	/* CLOCK_MONOTONIC ms of the next timeout, 0 : none */
+} pm_state_page;
+
+/*
+ * read a consistent snapshot of the state page
+ *
+ * @param[in] page state page mapped from PM_SHM_PATH
+ * @param[out] out snapshot
+ * @return 0 : success, -1 : not a valid state page
+ */
+static inline int pm_shm_read(const pm_state_page *page, pm_state_page *out)
+{
+	unsigned int seq;
+
+	if (page->magic != PM_SHM_MAGIC || page->version != PM_SHM_VERSION)
+		return -1;
+
+	do {
+		while ((seq = page->seq) & 0x1)
+			;
+		__sync_synchronize();
+		*out = *page;
+		__sync_synchronize();
+	} while (seq != page->seq);
+
+	return 0;
+}
+
+/**
+ * @}
+ */
+
+#endif				/*__PM_STATE_H__ */
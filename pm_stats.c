@@ -0,0 +1,137 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_stats.c
+ * @version	0.1
+ * @brief	Power manager state machine metrics
+ *
+ * Everything is updated from the main loop, so no locking is needed.
+ * The residency uses CLOCK_BOOTTIME, the time in suspend is counted in S_SLEEP.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "util.h"
+#include "pm_core.h"
+#include "pm_stats.h"
+
+static int stats_state;
+static long long state_entered;			/* ms */
+static long long residency[S_END];		/* ms */
+static unsigned int entries[S_END];
+static unsigned int transitions[S_END][S_END];
+static unsigned int action_hist[S_END][PM_STATS_BUCKETS];
+static long long stats_started;			/* ms */
+
+void init_pm_stats(int state)
+{
+	stats_state = state;
+	stats_started = state_entered = get_boottime_ms();
+	entries[state]++;
+}
+
+void pm_stats_transition(int from, int to)
+{
+	long long now = get_boottime_ms();
+
+	if (from < 0 || from >= S_END || to < 0 || to >= S_END)
+		return;
+
+	residency[stats_state] += now - state_entered;
+	state_entered = now;
+	stats_state = to;
+
+	entries[to]++;
+	transitions[from][to]++;
+}
+
+void pm_stats_action(int state, long long usec)
+{
+	int bucket = 0;
+
+	if (state < 0 || state >= S_END)
+		return;
+
+	while (usec > 0 && bucket < PM_STATS_BUCKETS - 1) {
+		usec >>= 1;
+		bucket++;
+	}
+	action_hist[state][bucket]++;
+}
+
+void pm_stats_print(int fd)
+{
+	char buf[512];
+	long long now = get_boottime_ms();
+	long long res;
+	int len, i, j;
+
+	if (fd < 0)
+		return;
+
+	len = snprintf(buf, sizeof(buf), "uptime(ms) %lld\n"
+		       "state      residency(ms) entries\n",
+		       now - stats_started);
+	write(fd, buf, len);
+	for (i = S_NORMAL; i < S_END; i++) {
+		res = residency[i];
+		if (i == stats_state)
+			res += now - state_entered;
+		len = snprintf(buf, sizeof(buf), "%-10s %13lld %7u\n",
+			       state_string[i], res, entries[i]);
+		write(fd, buf, len);
+	}
+
+	len = snprintf(buf, sizeof(buf), "\ntransitions\n");
+	write(fd, buf, len);
+	for (i = 0; i < S_END; i++) {
+		for (j = 0; j < S_END; j++) {
+			if (transitions[i][j] == 0)
+				continue;
+			len = snprintf(buf, sizeof(buf), "%-10s -> %-10s %7u\n",
+				       state_string[i],
+				       state_string[j], transitions[i][j]);
+			write(fd, buf, len);
+		}
+	}
+
+	len = snprintf(buf, sizeof(buf),
+		       "\naction latency(us) : log2 buckets <upper bound:count>\n");
+	write(fd, buf, len);
+	for (i = S_NORMAL; i < S_END; i++) {
+		len = snprintf(buf, sizeof(buf), "%-10s", state_string[i]);
+		for (j = 0; j < PM_STATS_BUCKETS; j++) {
+			if (action_hist[i][j] == 0 || len >= sizeof(buf))
+				continue;
+			if (j == PM_STATS_BUCKETS - 1)
+				len += snprintf(buf + len, sizeof(buf) - len,
+						" inf:%u", action_hist[i][j]);
+			else
+				len += snprintf(buf + len, sizeof(buf) - len,
+						" %d:%u", 1 << j,
+						action_hist[i][j]);
+		}
+		if (len < sizeof(buf))
+			len += snprintf(buf + len, sizeof(buf) - len, "\n");
+		if (len >= sizeof(buf))
+			len = sizeof(buf) - 1;
+		write(fd, buf, len);
+	}
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_stats.h
+ * @version	0.1
+ * @brief	Power manager state machine metrics
+ *
+ * Residency time and entry count of each state, transition count of each
+ * (from, to) edge and log2 histograms of the state action latency.
+ */
+#ifndef __PM_STATS_H__
+#define __PM_STATS_H__
+
+/**
+ * @addtogroup POWER_MANAGER
+ * @{
+ */
+
+/* bucket n counts the latencies in [2^(n-1), 2^n) us, the last is open */
+#define PM_STATS_BUCKETS	24
+
+/*
+ * start the residency time of the initial state
+ *
+ * @param[in] state initial state
+ */
+extern void init_pm_stats(int state);
+
+/*
+ * account a state transition, called before the enter action
+ */
+extern void pm_stats_transition(int from, int to);
+
+/*
+ * account the time spent in the enter action of state
+ *
+ * @param[in] usec CLOCK_MONOTONIC usec spent in the action
+ */
+extern void pm_stats_action(int state, long long usec);
+
+/*
+ * write a text snapshot of the metrics
+ *
+ * @param[in] fd file descriptor to write
+ */
+extern void pm_stats_print(int fd);
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,270 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_stub_plugin.c
+ * @version	0.1
+ * @brief	File backed device manager plugin for test and benchmark runs
+ *
+ * Built as libpm_stub_devman_plugin.so and loaded instead of the device
+ * plugin with PM_DEVMAN_PLUGIN=<path of the library>.
+ * Every value is kept in a file of PM_STUB_DIR (default /tmp/pm_stub) :
+ *  brightness, dimming, lcd_power, frame_rate, power_state, wakeup_count
+ * max_brightness and min_brightness are read from there if they exist.
+ * A suspend returns at once and counts a wakeup, as if woken up by a
+ * device.
+ *
+ * PM_STUB_LATENCY adds a delay in ms to the calls, to see how a slow
+ * device affects the daemon, e.g.
+ *  PM_STUB_LATENCY=5			every call takes 5 ms
+ *  PM_STUB_LATENCY=2,lcd_power=40,power_state=300
+ * The call classes are brightness, lcd_power, frame_rate, power_state
+ * and wakeup_count.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "devman_plugin_intf.h"
+
+#define DEFAULT_STUB_DIR	"/tmp/pm_stub"
+#define DEFAULT_MAX_BRT		100
+#define DEFAULT_MIN_BRT		1
+
+enum stub_call {
+	STUB_BRIGHTNESS,
+	STUB_LCD_POWER,
+	STUB_FRAME_RATE,
+	STUB_POWER_STATE,
+	STUB_WAKEUP_COUNT,
+	STUB_CALL_END
+};
+
+static const char *stub_call_name[STUB_CALL_END] = {
+	"brightness", "lcd_power", "frame_rate", "power_state", "wakeup_count"
+};
+
+static char stub_dir[PATH_MAX - NAME_MAX];
+static unsigned int stub_latency[STUB_CALL_END];	/* ms */
+
+static void stub_delay(enum stub_call call)
+{
+	struct timespec ts;
+
+	if (stub_latency[call] == 0)
+		return;
+
+	ts.tv_sec = stub_latency[call] / 1000;
+	ts.tv_nsec = (stub_latency[call] % 1000) * 1000000L;
+	while (nanosleep(&ts, &ts) < 0 && errno == EINTR) ;
+}
+
+static int stub_read(const char *name, int *value)
+{
+	char path[PATH_MAX];
+	char buf[32];
+	int fd, ret;
+
+	snprintf(path, sizeof(path), "%s/%s", stub_dir, name);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	ret = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (ret <= 0)
+		return -1;
+	buf[ret] = '\0';
+	*value = atoi(buf);
+
+	return 0;
+}
+
+static int stub_write(const char *name, int value)
+{
+	char path[PATH_MAX];
+	char buf[32];
+	int fd, len, ret;
+
+	snprintf(path, sizeof(path), "%s/%s", stub_dir, name);
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return -1;
+	len = snprintf(buf, sizeof(buf), "%d\n", value);
+	ret = write(fd, buf, len);
+	close(fd);
+
+	return ret == len ? 0 : -1;
+}
+
+static int stub_get_display_count(int *value)
+{
+	*value = 1;
+	return 0;
+}
+
+static int stub_get_max_brt(int index, int *value)
+{
+	if (stub_read("max_brightness", value) < 0)
+		*value = DEFAULT_MAX_BRT;
+	return 0;
+}
+
+static int stub_get_min_brt(int index, int *value)
+{
+	if (stub_read("min_brightness", value) < 0)
+		*value = DEFAULT_MIN_BRT;
+	return 0;
+}
+
+static int stub_get_brt(int index, int *value, int pmstate)
+{
+	stub_delay(STUB_BRIGHTNESS);
+	if (stub_read("brightness", value) < 0)
+		return stub_get_max_brt(index, value);
+	return 0;
+}
+
+static int stub_set_brt(int index, int value, int pmstate)
+{
+	stub_delay(STUB_BRIGHTNESS);
+	return stub_write("brightness", value);
+}
+
+static int stub_set_dimming(int index, int value)
+{
+	stub_delay(STUB_BRIGHTNESS);
+	return stub_write("dimming", value);
+}
+
+static int stub_get_lcd_power(int index, int *value)
+{
+	stub_delay(STUB_LCD_POWER);
+	if (stub_read("lcd_power", value) < 0)
+		*value = STATUS_ON;
+	return 0;
+}
+
+static int stub_set_lcd_power(int index, int value)
+{
+	stub_delay(STUB_LCD_POWER);
+	return stub_write("lcd_power", value);
+}
+
+static int stub_set_frame_rate(int value)
+{
+	stub_delay(STUB_FRAME_RATE);
+	return stub_write("frame_rate", value);
+}
+
+static int stub_get_wakeup_count(int *value)
+{
+	stub_delay(STUB_WAKEUP_COUNT);
+	if (stub_read("wakeup_count", value) < 0)
+		*value = 0;
+	return 0;
+}
+
+static int stub_set_wakeup_count(int value)
+{
+	int count;
+
+	stub_delay(STUB_WAKEUP_COUNT);
+	/* like the kernel, refuse a stale count */
+	if (stub_read("wakeup_count", &count) == 0 && count != value)
+		return -1;
+	return 0;
+}
+
+static int stub_set_power_state(int value)
+{
+	int count = 0;
+
+	stub_delay(STUB_POWER_STATE);
+	if (stub_write("power_state", value) < 0)
+		return -1;
+	if (value != POWER_STATE_SUSPEND)
+		return 0;
+
+	stub_read("wakeup_count", &count);
+	return stub_write("wakeup_count", count + 1);
+}
+
+static const OEM_sys_devman_plugin_interface stub_plugin = {
+	.OEM_sys_get_display_count = stub_get_display_count,
+	.OEM_sys_get_backlight_min_brightness = stub_get_min_brt,
+	.OEM_sys_get_backlight_max_brightness = stub_get_max_brt,
+	.OEM_sys_get_backlight_brightness = stub_get_brt,
+	.OEM_sys_set_backlight_brightness = stub_set_brt,
+	.OEM_sys_set_backlight_dimming = stub_set_dimming,
+	.OEM_sys_get_lcd_power = stub_get_lcd_power,
+	.OEM_sys_set_lcd_power = stub_set_lcd_power,
+	.OEM_sys_set_display_frame_rate = stub_set_frame_rate,
+	.OEM_sys_set_power_state = stub_set_power_state,
+	.OEM_sys_get_power_wakeup_count = stub_get_wakeup_count,
+	.OEM_sys_set_power_wakeup_count = stub_set_wakeup_count,
+};
+
+/* "<ms>" sets every class, "<class>=<ms>" one of them */
+static void parse_latency(const char *spec)
+{
+	char *buf, *tok, *save, *eq;
+	int i;
+
+	buf = strdup(spec);
+	if (buf == NULL)
+		return;
+
+	for (tok = strtok_r(buf, ",", &save); tok != NULL;
+	     tok = strtok_r(NULL, ",", &save)) {
+		eq = strchr(tok, '=');
+		if (eq == NULL) {
+			for (i = 0; i < STUB_CALL_END; i++)
+				stub_latency[i] = atoi(tok);
+			continue;
+		}
+		*eq = '\0';
+		for (i = 0; i < STUB_CALL_END; i++) {
+			if (!strcmp(tok, stub_call_name[i]))
+				stub_latency[i] = atoi(eq + 1);
+		}
+	}
+
+	free(buf);
+}
+
+const OEM_sys_devman_plugin_interface *OEM_sys_get_devman_plugin_interface(void)
+{
+	const char *env;
+
+	env = getenv("PM_STUB_DIR");
+	snprintf(stub_dir, sizeof(stub_dir), "%s",
+		 env != NULL ? env : DEFAULT_STUB_DIR);
+	mkdir(stub_dir, 0755);
+
+	env = getenv("PM_STUB_LATENCY");
+	if (env != NULL)
+		parse_latency(env);
+
+	return &stub_plugin;
+}
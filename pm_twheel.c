@@ -0,0 +1,322 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_twheel.c
+ * @version	0.1
+ * @brief	Power manager timer wheel for lock expirations
+ *
+ * TWHEEL_LEVELS levels of TWHEEL_SLOTS slots. Level n holds the timers
+ * which expire within TWHEEL_SLOTS^(n+1) ticks, and its slots are
+ * cascaded into the lower level when the lower level wraps around.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+
+#include "util.h"
+#include "pm_poll.h"
+#include "pm_twheel.h"
+
+#define TWHEEL_BITS		6
+#define TWHEEL_SLOTS		(1 << TWHEEL_BITS)
+#define TWHEEL_MASK		(TWHEEL_SLOTS - 1)
+#define TWHEEL_LEVELS		4
+#define TWHEEL_MAX_TICKS	(1ULL << (TWHEEL_BITS * TWHEEL_LEVELS))
+
+#define LEVEL_INDEX(tick, l)	(((tick) >> (TWHEEL_BITS * (l))) & TWHEEL_MASK)
+
+static twheel_timer *slots[TWHEEL_LEVELS][TWHEEL_SLOTS];
+static int level_count[TWHEEL_LEVELS];
+static unsigned long long wheel_tick;	/* the next tick to be processed */
+static long long wheel_base;		/* CLOCK_MONOTONIC ms of tick 0 */
+static unsigned long long armed_tick;	/* 0 : timerfd is not armed */
+static int tfd = -1;
+static pm_watch *tfd_watch;
+
+static unsigned long long now_tick(void)
+{
+	return (get_monotonic_ms() - wheel_base) / TWHEEL_TICK_MS;
+}
+
+static void link_timer(twheel_timer *t, int level, int idx)
+{
+	twheel_timer **head = &slots[level][idx];
+
+	t->next = *head;
+	if (*head != NULL)
+		(*head)->pprev = &t->next;
+	*head = t;
+	t->pprev = head;
+	t->level = level;
+	level_count[level]++;
+}
+
+/*
+ * get the level and the tick of the slot of a timer
+ * A timer beyond the wheel goes to the last slot of the top level and
+ * is queued again from there, its expires is kept.
+ */
+static int timer_level(twheel_timer *t, unsigned long long *tick)
+{
+	unsigned long long delta;
+	int l;
+
+	if (t->expires < wheel_tick)
+		t->expires = wheel_tick;
+	*tick = t->expires;
+	delta = t->expires - wheel_tick;
+	if (delta >= TWHEEL_MAX_TICKS) {
+		*tick = wheel_tick + TWHEEL_MAX_TICKS - 1;
+		delta = TWHEEL_MAX_TICKS - 1;
+	}
+
+	for (l = 0; l < TWHEEL_LEVELS - 1; l++) {
+		if (delta < (1ULL << (TWHEEL_BITS * (l + 1))))
+			break;
+	}
+	return l;
+}
+
+static void insert_timer(twheel_timer *t)
+{
+	unsigned long long tick;
+	int l = timer_level(t, &tick);
+
+	link_timer(t, l, LEVEL_INDEX(tick, l));
+}
+
+static void unlink_timer(twheel_timer *t)
+{
+	*t->pprev = t->next;
+	if (t->next != NULL)
+		t->next->pprev = t->pprev;
+	t->next = NULL;
+	t->pprev = NULL;
+	level_count[t->level]--;
+}
+
+/*
+ * The first tick at which a timer of the level can become due
+ * (level 0) or must be cascaded (upper levels).
+ */
+static unsigned long long level_next_tick(int l)
+{
+	unsigned long long base = wheel_tick >> (TWHEEL_BITS * l);
+	unsigned long long tick;
+	int d;
+
+	for (d = 0; d <= TWHEEL_SLOTS; d++) {
+		tick = (base + d) << (TWHEEL_BITS * l);
+		if (tick < wheel_tick)
+			continue;
+		if (slots[l][(base + d) & TWHEEL_MASK] != NULL)
+			return tick;
+	}
+	return 0;
+}
+
+static void arm_timerfd(void)
+{
+	struct itimerspec its;
+	unsigned long long next = 0, tick;
+	long long msec;
+	int l;
+
+	for (l = 0; l < TWHEEL_LEVELS; l++) {
+		if (level_count[l] == 0)
+			continue;
+		tick = level_next_tick(l);
+		if (tick != 0 && (next == 0 || tick < next))
+			next = tick;
+	}
+
+	if (next == armed_tick)
+		return;
+
+	memset(&its, 0x0, sizeof(its));
+	if (next != 0) {
+		msec = wheel_base + (long long)next * TWHEEL_TICK_MS;
+		its.it_value.tv_sec = msec / 1000;
+		its.it_value.tv_nsec = (msec % 1000) * 1000000;
+	}
+	if (timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+		LOGERR("timerfd_settime error : %s", strerror(errno));
+		return;
+	}
+	armed_tick = next;
+}
+
+static void cascade(int level)
+{
+	twheel_timer *t, *head;
+	int idx = LEVEL_INDEX(wheel_tick, level);
+
+	head = slots[level][idx];
+	slots[level][idx] = NULL;
+	while (head != NULL) {
+		t = head;
+		head = t->next;
+		level_count[level]--;
+		t->next = NULL;
+		t->pprev = NULL;
+		insert_timer(t);
+	}
+}
+
+/* process every tick up to and including target */
+static void run_timers(unsigned long long target)
+{
+	twheel_timer *t, *head;
+	unsigned long long span;
+	int idx, l;
+
+	while (wheel_tick <= target) {
+		/* skip the ticks in which nothing can happen */
+		for (l = 0; l < TWHEEL_LEVELS && level_count[l] == 0; l++)
+			;
+		if (l == TWHEEL_LEVELS) {
+			wheel_tick = target + 1;
+			break;
+		}
+		if (l > 0) {
+			span = 1ULL << (TWHEEL_BITS * l);
+			if (wheel_tick & (span - 1)) {
+				wheel_tick = (wheel_tick | (span - 1)) + 1;
+				if (wheel_tick > target + 1)
+					wheel_tick = target + 1;
+				continue;
+			}
+		}
+
+		idx = wheel_tick & TWHEEL_MASK;
+		for (l = 1; l < TWHEEL_LEVELS; l++) {
+			if (LEVEL_INDEX(wheel_tick, l - 1) != 0)
+				break;
+			cascade(l);
+		}
+
+		/* detach the slot, the callbacks may add or delete timers */
+		head = slots[0][idx];
+		slots[0][idx] = NULL;
+		if (head != NULL)
+			head->pprev = &head;
+		wheel_tick++;
+		while (head != NULL) {
+			t = head;
+			unlink_timer(t);
+			/* not due yet, it was beyond the wheel */
+			if (t->expires >= wheel_tick) {
+				insert_timer(t);
+				continue;
+			}
+			if (t->func != NULL)
+				t->func(t);
+		}
+	}
+}
+
+static gboolean twheel_handler(int fd, void *data)
+{
+	uint64_t expirations;
+
+	if (read(fd, &expirations, sizeof(expirations)) < 0
+	    && errno != EAGAIN)
+		LOGERR("timerfd read error : %s", strerror(errno));
+
+	armed_tick = 0;
+	run_timers(now_tick());
+	arm_timerfd();
+
+	return TRUE;
+}
+
+void twheel_init_timer(twheel_timer *t, twheel_func func)
+{
+	t->next = NULL;
+	t->pprev = NULL;
+	t->expires = 0;
+	t->func = func;
+}
+
+void twheel_mod(twheel_timer *t, unsigned int msec)
+{
+	long long now_ms = get_monotonic_ms() - wheel_base;
+	unsigned long long now = now_ms / TWHEEL_TICK_MS;
+	int l;
+
+	if (twheel_pending(t))
+		unlink_timer(t);
+
+	/* an idle wheel does not need to replay the past ticks */
+	for (l = 0; l < TWHEEL_LEVELS && level_count[l] == 0; l++)
+		;
+	if (l == TWHEEL_LEVELS && wheel_tick < now)
+		wheel_tick = now;
+
+	/* round up, a lock must not expire before its timeout */
+	t->expires = (now_ms + msec + TWHEEL_TICK_MS - 1) / TWHEEL_TICK_MS;
+	insert_timer(t);
+
+	if (tfd >= 0 && (armed_tick == 0 || armed_tick > t->expires))
+		arm_timerfd();
+}
+
+void twheel_del(twheel_timer *t)
+{
+	if (twheel_pending(t))
+		unlink_timer(t);
+}
+
+int init_twheel(void)
+{
+	tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (tfd < 0) {
+		LOGERR("timerfd_create error : %s", strerror(errno));
+		return -1;
+	}
+
+	tfd_watch = pm_poll_add_fd(tfd, twheel_handler, NULL);
+	if (tfd_watch == NULL) {
+		close(tfd);
+		tfd = -1;
+		return -1;
+	}
+
+	wheel_base = get_monotonic_ms();
+	wheel_tick = 0;
+	armed_tick = 0;
+
+	return 0;
+}
+
+int exit_twheel(void)
+{
+	if (tfd < 0)
+		return 0;
+
+	pm_poll_del_fd(tfd_watch);
+	tfd_watch = NULL;
+	close(tfd);
+	tfd = -1;
+
+	return 0;
+}
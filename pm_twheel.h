@@ -0,0 +1,72 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_twheel.h
+ * @version	0.1
+ * @brief	Power manager timer wheel for lock expirations
+ *
+ * Hierarchical timer wheel driven by one timerfd in the pm_poll set.
+ * Adding, re-arming and deleting a timer are O(1). The timerfd is armed
+ * only for the next expiration, so an idle wheel never wakes the daemon.
+ */
+#ifndef __PM_TWHEEL_H__
+#define __PM_TWHEEL_H__
+
+#include <stddef.h>
+
+/**
+ * @addtogroup POWER_MANAGER
+ * @{
+ */
+
+#define TWHEEL_TICK_MS		10
+
+typedef struct _twheel_timer twheel_timer;
+typedef void (*twheel_func) (twheel_timer *t);
+
+struct _twheel_timer {
+	twheel_timer *next;
+	twheel_timer **pprev;		/**< NULL : not pending */
+	unsigned long long expires;	/**< in ticks */
+	int level;
+	twheel_func func;
+};
+
+/* get the structure which embeds the timer */
+#define twheel_entry(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define twheel_pending(t)	((t)->pprev != NULL)
+
+extern int init_twheel(void);
+extern int exit_twheel(void);
+
+extern void twheel_init_timer(twheel_timer *t, twheel_func func);
+
+/*
+ * (re)arm a timer to expire after msec from now
+ * If the timer is pending, only its deadline is updated.
+ */
+extern void twheel_mod(twheel_timer *t, unsigned int msec);
+extern void twheel_del(twheel_timer *t);
+
+/**
+ * @}
+ */
+
+#endif				/*__PM_TWHEEL_H__ */
@@ -0,0 +1,429 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_uevent.c
+ * @version	0.1
+ * @brief	Kernel uevent listener for the input and power_supply hotplug
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <limits.h>
+#include <linux/netlink.h>
+
+#include "util.h"
+#include "pm_poll.h"
+#include "pm_uevent.h"
+
+#define UEVENT_BUFFER_SIZE	2048
+#define UEVENT_RCVBUF		(128 * 1024)
+
+enum {
+	UEVENT_INPUT,
+	UEVENT_POWER,
+};
+
+typedef struct {
+	char *key;		/* device node or power supply name */
+	int type;
+	int add;		/* last action of an input device */
+	guint id;
+} uevent_pending;
+
+/* last seen state of a power supply */
+typedef struct {
+	char *online;		/* POWER_SUPPLY_ONLINE */
+	char *status;		/* POWER_SUPPLY_STATUS */
+} supply_state;
+
+static int uevent_fd = -1;
+static pm_watch *uevent_watch;
+static char *stub_path;
+static GHashTable *pendings;
+static GHashTable *supplies;
+static uevent_input_fn input_changed;
+static uevent_power_fn power_changed;
+
+static unsigned int received;
+static unsigned int ignored;
+static unsigned int coalesced;
+static unsigned int unchanged;	/* power_supply without a plug change */
+static unsigned int delivered;
+static unsigned int overflows;
+
+static void free_pending(gpointer data)
+{
+	uevent_pending *p = (uevent_pending *) data;
+
+	if (p->id)
+		g_source_remove(p->id);
+	g_free(p->key);
+	g_free(p);
+}
+
+static void free_supply(gpointer data)
+{
+	supply_state *st = (supply_state *) data;
+
+	g_free(st->online);
+	g_free(st->status);
+	g_free(st);
+}
+
+/*
+ * Most power_supply uevents are capacity or voltage updates. Only an
+ * ONLINE or STATUS change of the supply, or its removal, is forwarded.
+ * @return 1 : changed
+ */
+static int supply_changed(const char *name, const char *action,
+			  const char *online, const char *status)
+{
+	supply_state *st;
+	int changed = 0;
+
+	if (!strcmp(action, "remove"))
+		return g_hash_table_remove(supplies, name);
+
+	st = (supply_state *) g_hash_table_lookup(supplies, name);
+	if (st == NULL) {
+		st = g_new0(supply_state, 1);
+		g_hash_table_insert(supplies, g_strdup(name), st);
+	}
+	if (online != NULL && g_strcmp0(online, st->online)) {
+		g_free(st->online);
+		st->online = g_strdup(online);
+		changed = 1;
+	}
+	if (status != NULL && g_strcmp0(status, st->status)) {
+		g_free(st->status);
+		st->status = g_strdup(status);
+		changed = 1;
+	}
+
+	return changed;
+}
+
+static gboolean pending_expired(gpointer data)
+{
+	uevent_pending *p = (uevent_pending *) data;
+
+	p->id = 0;
+	delivered++;
+	if (p->type == UEVENT_INPUT) {
+		LOGINFO("%s input device %s", p->add ? "add" : "remove",
+			p->key);
+		input_changed(p->add, p->key);
+	} else {
+		LOGINFO("power supply %s changed", p->key);
+		power_changed(p->key);
+	}
+	g_hash_table_remove(pendings, p->key);
+
+	return FALSE;
+}
+
+static void queue_event(int type, const char *key, int add)
+{
+	uevent_pending *p;
+
+	p = (uevent_pending *) g_hash_table_lookup(pendings, key);
+	if (p != NULL) {
+		coalesced++;
+		g_source_remove(p->id);
+	} else {
+		p = g_new0(uevent_pending, 1);
+		p->key = g_strdup(key);
+		p->type = type;
+		g_hash_table_insert(pendings, p->key, p);
+	}
+	p->add = add;
+	p->id = g_timeout_add(UEVENT_DEBOUNCE, pending_expired, p);
+}
+
+/* event[1-9]* node of an input[1-9]* device, the built-in ones are not */
+static int hotplug_input(const char *devname, const char *devpath)
+{
+	const char *p;
+
+	if (strncmp(devname, "input/event", 11)
+	    || devname[11] < '1' || devname[11] > '9')
+		return 0;
+
+	for (p = strstr(devpath, "/input"); p; p = strstr(p + 1, "/input"))
+		if (p[6] >= '1' && p[6] <= '9')
+			return 1;
+
+	return 0;
+}
+
+static void parse_uevent(const char *buf, int len)
+{
+	const char *action = NULL, *subsystem = NULL;
+	const char *devname = NULL, *devpath = NULL, *supply = NULL;
+	const char *online = NULL, *status = NULL;
+	char path[PATH_MAX];
+	const char *s;
+	int add;
+
+	/* "<action>@<devpath>" and then KEY=value fields */
+	if (strchr(buf, '@') == NULL) {
+		ignored++;
+		return;
+	}
+	for (s = buf + strlen(buf) + 1; s < buf + len; s += strlen(s) + 1) {
+		if (!strncmp(s, "ACTION=", 7))
+			action = s + 7;
+		else if (!strncmp(s, "SUBSYSTEM=", 10))
+			subsystem = s + 10;
+		else if (!strncmp(s, "DEVNAME=", 8))
+			devname = s + 8;
+		else if (!strncmp(s, "DEVPATH=", 8))
+			devpath = s + 8;
+		else if (!strncmp(s, "POWER_SUPPLY_NAME=", 18))
+			supply = s + 18;
+		else if (!strncmp(s, "POWER_SUPPLY_ONLINE=", 20))
+			online = s + 20;
+		else if (!strncmp(s, "POWER_SUPPLY_STATUS=", 20))
+			status = s + 20;
+	}
+	if (action == NULL || subsystem == NULL || devpath == NULL) {
+		ignored++;
+		return;
+	}
+
+	if (!strcmp(subsystem, "input") && devname != NULL
+	    && hotplug_input(devname, devpath)) {
+		if (!strcmp(action, "add"))
+			add = 1;
+		else if (!strcmp(action, "remove"))
+			add = 0;
+		else
+			goto out;
+		snprintf(path, sizeof(path), "/dev/%s", devname);
+		queue_event(UEVENT_INPUT, path, add);
+		return;
+	}
+
+	if (!strcmp(subsystem, "power_supply")) {
+		if (supply == NULL) {
+			supply = strrchr(devpath, '/');
+			supply = supply ? supply + 1 : devpath;
+		}
+		if (supply_changed(supply, action, online, status))
+			queue_event(UEVENT_POWER, supply, 0);
+		else
+			unchanged++;
+		return;
+	}
+
+out:
+	ignored++;
+}
+
+static gboolean uevent_handler(int fd, void *data)
+{
+	char buf[UEVENT_BUFFER_SIZE];
+	struct sockaddr_nl snl;
+	struct iovec iov;
+	struct msghdr msg;
+	int len;
+
+	for (;;) {
+		iov.iov_base = buf;
+		iov.iov_len = sizeof(buf) - 1;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		if (stub_path == NULL) {
+			msg.msg_name = &snl;
+			msg.msg_namelen = sizeof(snl);
+		}
+
+		len = recvmsg(fd, &msg, 0);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == ENOBUFS) {
+				/* the kernel dropped uevents, go on */
+				LOGERR("uevent receive queue overflow");
+				overflows++;
+				continue;
+			}
+			if (errno != EAGAIN)
+				LOGERR("uevent recv error : %s", strerror(errno));
+			break;
+		}
+		received++;
+
+		/* only the kernel, not the uevents of other processes */
+		if (stub_path == NULL && snl.nl_pid != 0) {
+			ignored++;
+			continue;
+		}
+		if (msg.msg_flags & MSG_TRUNC) {
+			ignored++;
+			continue;
+		}
+		buf[len] = '\0';
+		parse_uevent(buf, len);
+	}
+
+	return TRUE;
+}
+
+static int open_netlink(void)
+{
+	struct sockaddr_nl snl;
+	int size = UEVENT_RCVBUF;
+	int fd;
+
+	fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		    NETLINK_KOBJECT_UEVENT);
+	if (fd < 0) {
+		LOGERR("uevent socket error : %s", strerror(errno));
+		return -1;
+	}
+
+	/* a burst of hotplug must not overflow, FORCE needs CAP_NET_ADMIN */
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0)
+		setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+	memset(&snl, 0, sizeof(snl));
+	snl.nl_family = AF_NETLINK;
+	snl.nl_groups = 1;	/* kernel uevents */
+	if (bind(fd, (struct sockaddr *)&snl, sizeof(snl)) < 0) {
+		LOGERR("uevent bind error : %s", strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static int open_stub(const char *path)
+{
+	struct sockaddr_un sun;
+	int fd;
+
+	if (strlen(path) >= sizeof(sun.sun_path)) {
+		LOGERR("uevent socket path is too long : %s", path);
+		return -1;
+	}
+
+	fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		LOGERR("uevent socket error : %s", strerror(errno));
+		return -1;
+	}
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	strcpy(sun.sun_path, path);
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&sun, sizeof(sun)) < 0) {
+		LOGERR("uevent bind error %s : %s", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+int init_pm_uevent(uevent_input_fn input_fn, uevent_power_fn power_fn)
+{
+	char *path;
+
+	input_changed = input_fn;
+	power_changed = power_fn;
+
+	path = getenv("PM_UEVENT_SOCKET");
+	if (path != NULL && path[0] != '\0') {
+		stub_path = strdup(path);
+		uevent_fd = open_stub(stub_path);
+	} else {
+		uevent_fd = open_netlink();
+	}
+	if (uevent_fd < 0)
+		goto err;
+
+	uevent_watch = pm_poll_add_fd(uevent_fd, uevent_handler, NULL);
+	if (uevent_watch == NULL)
+		goto err;
+
+	pendings = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+					 free_pending);
+	supplies = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					 free_supply);
+	LOGINFO("uevent listener on %s", stub_path ? stub_path : "netlink");
+
+	return 0;
+
+err:
+	exit_pm_uevent();
+	return -1;
+}
+
+int exit_pm_uevent(void)
+{
+	if (pendings != NULL) {
+		g_hash_table_destroy(pendings);
+		pendings = NULL;
+	}
+	if (supplies != NULL) {
+		g_hash_table_destroy(supplies);
+		supplies = NULL;
+	}
+	if (uevent_watch != NULL) {
+		pm_poll_del_fd(uevent_watch);
+		uevent_watch = NULL;
+	}
+	if (uevent_fd >= 0) {
+		close(uevent_fd);
+		uevent_fd = -1;
+	}
+	if (stub_path != NULL) {
+		unlink(stub_path);
+		free(stub_path);
+		stub_path = NULL;
+	}
+
+	return 0;
+}
+
+void pm_uevent_print(int fd)
+{
+	char buf[256];
+	int len;
+
+	if (fd < 0)
+		return;
+
+	len = snprintf(buf, sizeof(buf),
+		       "source %s : received %u, ignored %u, unchanged %u, "
+		       "coalesced %u, delivered %u, pending %u, overflows %u\n",
+		       stub_path ? stub_path : "netlink", received, ignored,
+		       unchanged, coalesced, delivered,
+		       pendings ? g_hash_table_size(pendings) : 0, overflows);
+	write(fd, buf, len);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	pm_uevent.h
+ * @version	0.1
+ * @brief	Kernel uevent listener for the input and power_supply hotplug
+ *
+ * The uevents come from the kernel on a NETLINK_KOBJECT_UEVENT socket.
+ * With PM_UEVENT_SOCKET set, they are read from a datagram socket bound
+ * to that path instead, so a test can send them in the kernel format :
+ * "<action>@<devpath>\0ACTION=<action>\0SUBSYSTEM=<subsystem>\0...".
+ *
+ * The events of a device are held for UEVENT_DEBOUNCE ms after the last
+ * one and only the last action is delivered, so a flapping device costs
+ * one reopen. The added input devices are the hotplugged event nodes,
+ * /dev/input/event[1-9]* under an input[1-9]* device. A power supply
+ * is reported when its POWER_SUPPLY_ONLINE or POWER_SUPPLY_STATUS value
+ * differs from the last one seen, or when it is removed; the capacity
+ * and voltage updates are not.
+ */
+#ifndef __PM_UEVENT_H__
+#define __PM_UEVENT_H__
+
+/**
+ * @addtogroup POWER_MANAGER
+ * @{
+ */
+
+#define UEVENT_DEBOUNCE	200	/* ms */
+
+/*
+ * input device change
+ *
+ * @param[in] add 1 : the device node is new, open it (again), 0 : gone
+ * @param[in] path device node, e.g. /dev/input/event3
+ */
+typedef void (*uevent_input_fn) (int add, const char *path);
+
+/*
+ * power supply change, e.g. a charger plugged or charging stopped
+ *
+ * @param[in] name power supply name, e.g. usb
+ */
+typedef void (*uevent_power_fn) (const char *name);
+
+extern int init_pm_uevent(uevent_input_fn input_fn, uevent_power_fn power_fn);
+extern int exit_pm_uevent(void);
+
+/*
+ * print the uevent counters
+ */
+extern void pm_uevent_print(int fd);
+
+/**
+ * @}
+ */
+
+#endif				/*__PM_UEVENT_H__ */
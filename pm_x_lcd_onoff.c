@@ -15,52 +15,201 @@
 */
 
 
+/*
+ * LCD on/off by X DPMS
+ *
+ * The commands go to a resident helper (pm_dpms_helper, or the program
+ * of PM_DPMS_HELPER) over a socket on its stdin/stdout : one line "on"
+ * or "off" per command, answered by a line "ok" or "err". The helper
+ * keeps its X connection, so a toggle costs no process creation.
+ * A helper which dies after it has answered, e.g. when the X server
+ * restarted, is started again for the same command. One which does not
+ * answer its first command is started again at the next one, and xset
+ * is run for the command. A helper which cannot be started at all, e.g.
+ * not installed, is not tried again : xset is run for every command.
+ */
+
 #ifndef __PM_X_LCD_ONOFF_C__
 #define __PM_X_LCD_ONOFF_C__
 
 #include <string.h>
 #include <sys/wait.h>
+#include <sys/socket.h>
 #include <errno.h>
+#include <poll.h>
+#include <spawn.h>
 
 #include "pm_device_plugin.h"
 
 #define CMD_STANDBY	"standby"
 #define CMD_OFF		"off"
 
-static int pm_x_set_lcd_backlight(struct _PMSys *p, int onoff)
+#ifndef DPMS_HELPER_PATH
+#define DPMS_HELPER_PATH	"/usr/bin/pm_dpms_helper"
+#endif
+#define DPMS_ACK_TIMEOUT	1000	/* ms */
+
+extern char **environ;
+
+static int dpms_fd = -1;
+static pid_t dpms_pid;
+static int dpms_answered;	/* the running helper answered once */
+static int dpms_disabled;	/* it could not be started, xset is used */
+
+static void stop_dpms_helper(void)
 {
-	pid_t pid;
-	char cmd_line[32];
+	if (dpms_fd < 0)
+		return;
+	close(dpms_fd);
+	dpms_fd = -1;
+	/* it may be stuck in X, so it does not get the chance to exit */
+	kill(dpms_pid, SIGKILL);
+	while (waitpid(dpms_pid, NULL, 0) < 0 && errno == EINTR) ;
+}
+
+static int start_dpms_helper(void)
+{
+	posix_spawn_file_actions_t actions;
+	char *argv[2];
+	char *path;
+	int sv[2];
 	int ret;
 
-	LOGINFO("Backlight onoff=%d", onoff);
-	if (onoff == STATUS_ON)
-		snprintf(cmd_line, sizeof(cmd_line), "%s", CMD_STANDBY);
-	else
-		snprintf(cmd_line, sizeof(cmd_line), "%s", CMD_OFF);
+	path = getenv("PM_DPMS_HELPER");
+	if (path == NULL || path[0] == '\0')
+		path = DPMS_HELPER_PATH;
 
-	signal(SIGCHLD, SIG_DFL);
-	pid = vfork();
+	/* an old posix_spawn reports a failed exec by the exit of the child */
+	if (access(path, X_OK) < 0) {
+		LOGERR("cannot start %s : %s, xset is used", path,
+		       strerror(errno));
+		return -1;
+	}
 
-	if (pid < 0) {
-		LOGERR("[1] Failed to fork child process for LCD On/Off");
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+		LOGERR("dpms helper socketpair error : %s", strerror(errno));
 		return -1;
 	}
+	fcntl(sv[0], F_SETFD, FD_CLOEXEC);
 
-	if (pid == 0) {
-		LOGINFO("[1] Child proccess for LCD %s was created (%s)",
-			((onoff == STATUS_ON) ? "ON" : "OFF"), cmd_line);
-		execl("/usr/bin/xset", "/usr/bin/xset", "dpms", "force",
-		      cmd_line, NULL);
-		_exit(0);
-	} else if (pid != (ret = waitpid(pid, NULL, 0))) {
-		LOGERR
-		    ("[1] Waiting failed for the child process pid: %d, ret: %d, errno: %d",
-		     pid, ret, errno);
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, sv[1], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, sv[1], STDOUT_FILENO);
+	posix_spawn_file_actions_addclose(&actions, sv[1]);
+	argv[0] = path;
+	argv[1] = NULL;
+	ret = posix_spawn(&dpms_pid, path, &actions, NULL, argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	close(sv[1]);
+	if (ret != 0) {
+		LOGERR("cannot start %s : %s", path, strerror(ret));
+		close(sv[0]);
+		return -1;
 	}
 
-	signal(SIGCHLD, SIG_IGN);
+	dpms_fd = sv[0];
+	dpms_answered = 0;
+	LOGINFO("dpms helper %s started, pid %d", path, dpms_pid);
 	return 0;
 }
 
+/* send a command and wait for its answer, -1 : the helper is gone */
+static int dpms_helper_cmd(const char *cmd)
+{
+	struct pollfd pfd;
+	char buf[16];
+	int len = 0, ret;
+
+	if (dpms_disabled)
+		return -1;
+	if (dpms_fd < 0 && start_dpms_helper() < 0) {
+		dpms_disabled = 1;
+		return -1;
+	}
+
+	snprintf(buf, sizeof(buf), "%s\n", cmd);
+	if (send(dpms_fd, buf, strlen(buf), MSG_NOSIGNAL) < 0)
+		goto broken;
+
+	pfd.fd = dpms_fd;
+	pfd.events = POLLIN;
+	while (len == 0 || buf[len - 1] != '\n') {
+		ret = poll(&pfd, 1, DPMS_ACK_TIMEOUT);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0 || len >= sizeof(buf) - 1)
+			goto broken;
+		ret = read(dpms_fd, buf + len, sizeof(buf) - 1 - len);
+		if (ret <= 0)
+			goto broken;
+		len += ret;
+	}
+	buf[len - 1] = '\0';
+	dpms_answered = 1;
+
+	if (strcmp(buf, "ok")) {
+		LOGERR("dpms helper : %s %s", cmd, buf);
+		return 1;
+	}
+	return 0;
+
+broken:
+	LOGERR("dpms helper does not answer to %s", cmd);
+	stop_dpms_helper();
+	return -1;
+}
+
+/* the former way : one xset process per command */
+static int dpms_xset(int onoff)
+{
+	char *argv[5];
+	pid_t pid;
+	int ret, status;
+
+	argv[0] = "/usr/bin/xset";
+	argv[1] = "dpms";
+	argv[2] = "force";
+	argv[3] = (onoff == STATUS_ON) ? CMD_STANDBY : CMD_OFF;
+	argv[4] = NULL;
+
+	ret = posix_spawn(&pid, argv[0], NULL, NULL, argv, environ);
+	if (ret != 0) {
+		LOGERR("[1] Failed to start xset for LCD On/Off : %s",
+		       strerror(ret));
+		return -1;
+	}
+
+	while ((ret = waitpid(pid, &status, 0)) < 0 && errno == EINTR) ;
+	if (ret != pid) {
+		LOGERR("[1] Waiting failed for the child process pid: %d, errno: %d",
+		       pid, errno);
+		return -1;
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		LOGERR("xset dpms force %s failed, status %d", argv[3], status);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int pm_x_set_lcd_backlight(struct _PMSys *p, int onoff)
+{
+	const char *cmd = (onoff == STATUS_ON) ? "on" : "off";
+	int answered;
+	int ret;
+
+	LOGINFO("Backlight onoff=%d", onoff);
+
+	answered = (dpms_fd >= 0 && dpms_answered);
+	ret = dpms_helper_cmd(cmd);
+	/* a working helper died, e.g. the X server restarted : a new one */
+	if (ret < 0 && answered && !dpms_disabled)
+		ret = dpms_helper_cmd(cmd);
+	if (ret < 0)
+		return dpms_xset(onoff);
+
+	return ret > 0 ? -1 : 0;
+}
+
 #endif				/*__PM_X_LCD_ONOFF_C__ */
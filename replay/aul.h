@@ -15,26 +15,17 @@
 */
 
 
-#include <stdio.h>
-#include <string.h>
-#include <limits.h>
-
-#define PM_EVENT_NOTI_PATH     "/opt/share/noti/pm_event"
-
-int main(int argc, char *argv[])
-{
-	if(argc != 3) {
-		return -1;
-	}
-
-	if(strlen(argv[1]) + strlen(argv[2]) > PATH_MAX) {
-		return -1;
-	}
+/**
+ * @file	aul.h
+ * @version	0.1
+ * @brief	application utility library
+ *
+ * Stand-in of the platform header for pm_replay, see pm_replay_stubs.c.
+ * Only what the daemon sources use is declared.
+ */
+#ifndef __PM_REPLAY_AUL_H__
+#define __PM_REPLAY_AUL_H__
 
-	int i;
-	char buf[PATH_MAX + 25];
-	snprintf(buf, PATH_MAX + 25, "echo %s %s >> %s", argv[1], argv[2], PM_EVENT_NOTI_PATH);
-	system(buf);
+/* nothing of aul is used */
 
-	return 1;
-}
+#endif				/*__PM_REPLAY_AUL_H__ */
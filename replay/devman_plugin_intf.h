@@ -0,0 +1,55 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	devman_plugin_intf.h
+ * @version	0.1
+ * @brief	device manager plugin interface
+ *
+ * Stand-in of the platform header for pm_replay, see pm_replay_stubs.c.
+ * Only what the daemon sources use is declared.
+ */
+#ifndef __PM_REPLAY_DEVMAN_PLUGIN_INTF_H__
+#define __PM_REPLAY_DEVMAN_PLUGIN_INTF_H__
+
+enum {
+	STATUS_OFF = 0,
+	STATUS_ON,
+};
+
+enum {
+	POWER_STATE_SUSPEND = 0,
+	POWER_STATE_PRE_SUSPEND,
+	POWER_STATE_POST_RESUME,
+};
+
+typedef struct {
+	int (*OEM_sys_get_backlight_min_brightness) (int index, int *value);
+	int (*OEM_sys_get_backlight_max_brightness) (int index, int *value);
+	int (*OEM_sys_get_backlight_brightness) (int index, int *value,
+						 int pmstate);
+	int (*OEM_sys_set_backlight_brightness) (int index, int value,
+						 int pmstate);
+	int (*OEM_sys_set_backlight_dimming) (int index, int value);
+	int (*OEM_sys_set_lcd_power) (int index, int value);
+	int (*OEM_sys_set_display_frame_rate) (int value);
+	int (*OEM_sys_set_power_state) (int value);
+	int (*OEM_sys_get_power_wakeup_count) (int *value);
+	int (*OEM_sys_set_power_wakeup_count) (int value);
+} OEM_sys_devman_plugin_interface;
+
+#endif				/*__PM_REPLAY_DEVMAN_PLUGIN_INTF_H__ */
@@ -0,0 +1,31 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	heynoti.h
+ * @version	0.1
+ * @brief	heynoti notifications
+ *
+ * Stand-in of the platform header for pm_replay, see pm_replay_stubs.c.
+ * Only what the daemon sources use is declared.
+ */
+#ifndef __PM_REPLAY_HEYNOTI_H__
+#define __PM_REPLAY_HEYNOTI_H__
+
+int heynoti_publish(const char *noti);
+
+#endif				/*__PM_REPLAY_HEYNOTI_H__ */
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	sensor.h
+ * @version	0.1
+ * @brief	sensor framework
+ *
+ * Stand-in of the platform header for pm_replay, see pm_replay_stubs.c.
+ * Only what the daemon sources use is declared.
+ */
+#ifndef __PM_REPLAY_SENSOR_H__
+#define __PM_REPLAY_SENSOR_H__
+
+typedef enum {
+	UNKNOWN_SENSOR = 0x0000,
+	LIGHT_SENSOR = 0x0020,
+} sensor_type_t;
+
+#define LIGHT_BASE_DATA_SET	(LIGHT_SENSOR << 16 | 0x0001)
+
+typedef struct {
+	int data_accuracy;
+	int data_unit_idx;
+	unsigned long long time_stamp;
+	int values_num;
+	float values[12];
+} sensor_data_t;
+
+int sf_connect(sensor_type_t sensor_type);
+int sf_disconnect(int handle);
+int sf_start(int handle, int option);
+int sf_stop(int handle);
+int sf_get_data(int handle, unsigned int data_id, sensor_data_t *values);
+
+#endif				/*__PM_REPLAY_SENSOR_H__ */
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2012  Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.tizenopensource.org/license
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+/**
+ * @file	vconf-keys.h
+ * @version	0.1
+ * @brief	vconf keys used by the power manager
+ *
+ * Stand-in of the platform header for pm_replay, see pm_replay_stubs.c.
+ * Only what the daemon sources use is declared.
+ */
+#ifndef __PM_REPLAY_VCONF_KEYS_H__
+#define __PM_REPLAY_VCONF_KEYS_H__
+
+/* the key names are the ones of the device, for PM_SETTINGS_FILE */
+#define VCONFKEY_PM_STATE			"memory/pm/state"
+#define VCONFKEY_IDLE_LOCK_STATE		"memory/idle_lock/state"
+#define VCONFKEY_SYSMAN_BATTERY_STATUS_LOW	"memory/sysman/battery_status_low"
+#define VCONFKEY_SYSMAN_BATTERY_CHARGE_NOW	"memory/sysman/battery_charge_now"
+#define VCONFKEY_SYSMAN_USB_STATUS		"memory/sysman/usb_status"
+#define VCONFKEY_FLASHPLAYER_FULLSCREEN		"memory/flashplayer/fullscreen"
+#define VCONFKEY_SETAPPL_LCD_TIMEOUT_NORMAL	"db/setting/lcd_backlight_normal"
+#define VCONFKEY_SETAPPL_LCD_BRIGHTNESS		"db/setting/Brightness"
+#define VCONFKEY_SETAPPL_BRIGHTNESS_AUTOMATIC_INT "db/setting/automatic_brightness_level"
+#define VCONFKEY_SETAPPL_PWRSV_SYSMODE_STATUS	"db/setting/pwrsv/system_mode/status"
+#define VCONFKEY_SETAPPL_PWRSV_CUSTMODE_DISPLAY	"db/setting/pwrsv/custom_mode/display"
+#define VCONFKEY_TESTMODE_POWER_OFF_POPUP	"db/testmode/pwr_off_popup"
+
+enum {
+	VCONFKEY_IDLE_UNLOCK = 0,
+	VCONFKEY_IDLE_LOCK,
+};
+
+enum {
+	VCONFKEY_SYSMAN_BAT_POWER_OFF = 1,
+	VCONFKEY_SYSMAN_BAT_CRITICAL_LOW,
+	VCONFKEY_SYSMAN_BAT_WARNING_LOW,
+	VCONFKEY_SYSMAN_BAT_NORMAL,
+	VCONFKEY_SYSMAN_BAT_FULL,
+};
+
+enum {
+	SETTING_BRIGHTNESS_AUTOMATIC_OFF = 0,
+	SETTING_BRIGHTNESS_AUTOMATIC_ON,
+	SETTING_BRIGHTNESS_AUTOMATIC_PAUSE,
+};
+
+#endif				/*__PM_REPLAY_VCONF_KEYS_H__ */
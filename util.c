@@ -33,6 +33,7 @@
 #include <string.h>
 #include <signal.h>
 #include <errno.h>
+#include <time.h>
 
 #ifdef ENABLE_DLOG_OUT
 #define LOG_TAG		"POWER_MANAGER"
@@ -45,10 +46,322 @@
  * @{
  */
 
+/*
+ * trace ring
+ * Every log call is stored as a binary record: the format string
+ * pointer identifies the call site, and the arguments are kept raw.
+ * Records are formatted only when the ring is dumped.
+ */
+#define TRACE_RECORDS	1024
+#define TRACE_ARGS	6
+#define TRACE_STR	64
+
+enum trace_arg_type {
+	TRACE_INT,
+	TRACE_LONG,
+	TRACE_LLONG,
+	TRACE_PTR,
+	TRACE_STRING,
+	TRACE_DOUBLE,
+	TRACE_NONE,
+};
+
+typedef struct {
+	volatile unsigned int seq;	/* record index + 1 once written */
+	int priority;
+	long long time;			/* CLOCK_MONOTONIC usec */
+	const char *fmt;
+	union {
+		long long i;
+		double d;
+		const void *p;
+	} arg[TRACE_ARGS];
+	char str[TRACE_STR];		/* copied %s arguments */
+} trace_rec;
+
+static trace_rec trace_ring[TRACE_RECORDS];
+static unsigned int trace_head;
+static int log_console = -1;
+
+int pm_log_level = PM_LOG_LEVEL_INFO;
+
+/*
+ * parse one conversion specification
+ *
+ * @param[in] fmt points to the character after '%'
+ * @param[out] type argument type of the conversion
+ * @param[out] stars the number of '*' width/precision arguments
+ * @return the pointer to the character after the conversion
+ */
+static const char *parse_conv(const char *fmt, enum trace_arg_type *type,
+			      int *stars)
+{
+	int len = 0;
+
+	*stars = 0;
+	while (*fmt && strchr("-+ #0", *fmt))
+		fmt++;
+	if (*fmt == '*') {
+		(*stars)++;
+		fmt++;
+	}
+	while (*fmt >= '0' && *fmt <= '9')
+		fmt++;
+	if (*fmt == '.') {
+		fmt++;
+		if (*fmt == '*') {
+			(*stars)++;
+			fmt++;
+		}
+		while (*fmt >= '0' && *fmt <= '9')
+			fmt++;
+	}
+	while (*fmt && strchr("hlLqjzt", *fmt)) {
+		if (*fmt == 'l' || *fmt == 'q' || *fmt == 'L')
+			len++;
+		else if (*fmt != 'h')
+			len = 1;
+		fmt++;
+	}
+
+	switch (*fmt) {
+	case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+		*type = len >= 2 ? TRACE_LLONG : len ? TRACE_LONG : TRACE_INT;
+		break;
+	case 'p':
+	case 'n':
+		*type = TRACE_PTR;
+		break;
+	case 's':
+		*type = TRACE_STRING;
+		break;
+	case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+	case 'a': case 'A':
+		*type = TRACE_DOUBLE;
+		break;
+	default:
+		*type = TRACE_NONE;
+		return *fmt ? fmt + 1 : fmt;
+	}
+
+	return fmt + 1;
+}
+
+static void trace_record(int priority, const char *fmt, va_list ap)
+{
+	struct timespec ts;
+	enum trace_arg_type type;
+	unsigned int idx;
+	trace_rec *rec;
+	const char *p = fmt;
+	const char *str;
+	int stars, n = 0, used = 0, len;
+
+	idx = __sync_fetch_and_add(&trace_head, 1);
+	rec = &trace_ring[idx % TRACE_RECORDS];
+	rec->seq = 0;
+	__sync_synchronize();
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	rec->time = (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	rec->priority = priority;
+	rec->fmt = fmt;
+
+	while ((p = strchr(p, '%')) != NULL) {
+		if (p[1] == '%') {
+			p += 2;
+			continue;
+		}
+		p = parse_conv(p + 1, &type, &stars);
+		if (type == TRACE_NONE)
+			continue;
+		if (n + stars + 1 > TRACE_ARGS)
+			break;
+		while (stars-- > 0)
+			rec->arg[n++].i = va_arg(ap, int);
+
+		switch (type) {
+		case TRACE_INT:
+			rec->arg[n].i = va_arg(ap, int);
+			break;
+		case TRACE_LONG:
+			rec->arg[n].i = va_arg(ap, long);
+			break;
+		case TRACE_LLONG:
+			rec->arg[n].i = va_arg(ap, long long);
+			break;
+		case TRACE_PTR:
+			rec->arg[n].p = va_arg(ap, void *);
+			break;
+		case TRACE_DOUBLE:
+			rec->arg[n].d = va_arg(ap, double);
+			break;
+		case TRACE_STRING:
+			str = va_arg(ap, const char *);
+			if (str == NULL)
+				str = "(null)";
+			len = strnlen(str, TRACE_STR - used - 1);
+			memcpy(rec->str + used, str, len);
+			rec->str[used + len] = '\0';
+			rec->arg[n].i = used;
+			used += len + (used + len < TRACE_STR - 1);
+			break;
+		default:
+			break;
+		}
+		n++;
+	}
+
+	__sync_synchronize();
+	rec->seq = idx + 1;
+}
+
+/* format a record back into the message the call site wrote */
+static int trace_format(trace_rec *rec, char *buf, int size)
+{
+	enum trace_arg_type type;
+	const char *p = rec->fmt;
+	const char *conv;
+	char spec[32];
+	int stars, n = 0, pos = 0, w;
+
+	while (*p && pos < size - 1) {
+		if (*p != '%' || p[1] == '%') {
+			buf[pos++] = *p;
+			p += (*p == '%') ? 2 : 1;
+			continue;
+		}
+		conv = p;
+		p = parse_conv(p + 1, &type, &stars);
+		if (type == TRACE_NONE)
+			continue;
+		if (n + stars + 1 > TRACE_ARGS) {
+			pos += snprintf(buf + pos, size - pos, "...");
+			if (pos >= size)
+				pos = size - 1;
+			break;
+		}
+		if (p - conv >= sizeof(spec))
+			break;
+		memcpy(spec, conv, p - conv);
+		spec[p - conv] = '\0';
+
+		w = stars;
+#define TRACE_PRINT(v)							\
+		(w == 0 ? snprintf(buf + pos, size - pos, spec, v) :	\
+		 w == 1 ? snprintf(buf + pos, size - pos, spec,		\
+				   (int)rec->arg[n].i, v) :			\
+			  snprintf(buf + pos, size - pos, spec,		\
+				   (int)rec->arg[n].i, (int)rec->arg[n + 1].i, v))
+		switch (type) {
+		case TRACE_INT:
+			pos += TRACE_PRINT((int)rec->arg[n + w].i);
+			break;
+		case TRACE_LONG:
+			pos += TRACE_PRINT((long)rec->arg[n + w].i);
+			break;
+		case TRACE_LLONG:
+			pos += TRACE_PRINT(rec->arg[n + w].i);
+			break;
+		case TRACE_PTR:
+			if (spec[strlen(spec) - 1] == 'n')
+				break;
+			pos += TRACE_PRINT(rec->arg[n + w].p);
+			break;
+		case TRACE_DOUBLE:
+			pos += TRACE_PRINT(rec->arg[n + w].d);
+			break;
+		case TRACE_STRING:
+			pos += TRACE_PRINT(rec->str + rec->arg[n + w].i);
+			break;
+		default:
+			break;
+		}
+#undef TRACE_PRINT
+		n += w + 1;
+		if (pos >= size)
+			pos = size - 1;
+	}
+	buf[pos] = '\0';
+
+	return pos;
+}
+
+/**
+ * @brief write the trace ring to fd, from the oldest record
+ *
+ * @param[in] fd file descriptor to write
+ */
+void pm_log_dump(int fd)
+{
+	unsigned int head = trace_head;
+	unsigned int idx, seq;
+	trace_rec rec;
+	char msg[NAME_MAX];
+	char buf[NAME_MAX + 32];
+	int len;
+
+	if (fd < 0)
+		return;
+
+	idx = head > TRACE_RECORDS ? head - TRACE_RECORDS : 0;
+	for (; idx != head; idx++) {
+		seq = trace_ring[idx % TRACE_RECORDS].seq;
+		__sync_synchronize();
+		rec = trace_ring[idx % TRACE_RECORDS];
+		__sync_synchronize();
+		/* skip the records being written or overwritten */
+		if (seq != idx + 1 || trace_ring[idx % TRACE_RECORDS].seq != seq)
+			continue;
+
+		trace_format(&rec, msg, sizeof(msg));
+		len = snprintf(buf, sizeof(buf), "[%5lld.%06lld] %c %s\n",
+			       rec.time / 1000000, rec.time % 1000000,
+			       rec.priority == PM_LOG_ERR ? 'E' :
+			       rec.priority == PM_LOG_DEBUG ? 'D' : 'I', msg);
+		if (len >= sizeof(buf))
+			len = sizeof(buf) - 1;
+		write(fd, buf, len);
+	}
+}
+
+int pm_log_set_level(unsigned int level)
+{
+	if (level > PM_LOG_LEVEL_DEBUG)
+		return -EINVAL;
+
+	pm_log_level = level;
+	return 0;
+}
+
+int pm_log_ratelimit(pm_log_site *site, int priority, char *fmt)
+{
+	long long now = get_monotonic_ms();
+	long long start = site->start;
+	unsigned int missed;
+
+	/* a site may run on the HAL worker too, one thread opens the interval */
+	if (now - start >= PM_LOG_RATE_INTERVAL
+	    && __sync_bool_compare_and_swap(&site->start, start, now)) {
+		__sync_lock_test_and_set(&site->count, 0);
+		missed = __sync_lock_test_and_set(&site->missed, 0);
+		if (missed > 0)
+			pm_log(priority, "%u messages suppressed : %s",
+			       missed, fmt);
+	}
+
+	if (__sync_fetch_and_add(&site->count, 1) < PM_LOG_RATE_BURST)
+		return 1;
+	__sync_fetch_and_add(&site->missed, 1);
+	return 0;
+}
+
 /**
  * @brief logging function
  *
- * This is log wrapper
+ * Every message is stored in the trace ring, unformatted. A message
+ * within pm_log_level is also formatted and sent to the system log (or
+ * the console) at once; the others are formatted only when dumped.
  *
  * @param[in] priority log pritority
  * @param[in] fmt format string
@@ -57,28 +370,32 @@ void pm_log(int priority, char *fmt, ...)
 {
 	va_list ap;
 	char buf[NAME_MAX];	/* NAME_MAX is 255 */
+	int level;
+
+	va_start(ap, fmt);
+	trace_record(priority, fmt, ap);
+	va_end(ap);
+
+	level = priority == PM_LOG_ERR ? PM_LOG_LEVEL_ERR :
+	    priority == PM_LOG_DEBUG ? PM_LOG_LEVEL_DEBUG : PM_LOG_LEVEL_INFO;
+	if (level > pm_log_level)
+		return;
+	if (log_console < 0)
+		log_console = isatty(STDOUT_FILENO);
+
 	va_start(ap, fmt);
 	vsnprintf(buf, sizeof(buf), fmt, ap);
 	va_end(ap);
+	if (log_console)
+		printf("\x1b[1;33;44m[PowerManager] %s\x1b[0m\n\n", buf);
 #ifdef ENABLE_DLOG_OUT
-	switch (priority) {
-	case DLOG_DEBUG:
-		SLOGD("%s", buf);
-		break;
-	case DLOG_ERROR:
+	if (priority == PM_LOG_ERR)
 		SLOGE("%s", buf);
-		break;
-	case DLOG_INFO:
+	else
 		SLOGI("%s", buf);
-		break;
-	default:
-		SLOGV("%s", buf);
-		break;
-	}
 #else
 	syslog(priority, "%s", buf);
 #endif
-	printf("\x1b[1;33;44m[PowerManager] %s\x1b[0m\n\n", buf);
 }
 
 /**
@@ -89,7 +406,7 @@ void pm_log(int priority, char *fmt, ...)
  * @param[in] pidpath pid file path
  * @return 0 (always)
  */
-int writepid(char *pidpath)
+int writepid(const char *pidpath)
 {
 	FILE *fp;
 
@@ -110,7 +427,7 @@ int writepid(char *pidpath)
  * @param[in] pidpath pid file path
  * @return  pid : success, -1 : failed
  */
-int readpid(char *pidpath)
+int readpid(const char *pidpath)
 {
 	FILE *fp;
 	int ret = -1;
@@ -192,6 +509,64 @@ int exec_process(char *name)
 	return ret;
 }
 
+long long get_monotonic_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+long long get_boottime_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_BOOTTIME, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+#define RUNTIME_PATHS	8
+
+const char *runtime_path(const char *path)
+{
+	static struct {
+		const char *path;
+		char *full;
+	} paths[RUNTIME_PATHS];
+	static char *root;
+	const char *name;
+	int i;
+
+	if (root == NULL) {
+		root = getenv("PM_RUNTIME_ROOT");
+		if (root == NULL || root[0] == '\0')
+			root = "";
+		else
+			mkdir(root, 0755);
+	}
+	if (root[0] == '\0')
+		return path;
+
+	for (i = 0; i < RUNTIME_PATHS && paths[i].path != NULL; i++) {
+		if (!strcmp(paths[i].path, path))
+			return paths[i].full;
+	}
+	if (i == RUNTIME_PATHS) {
+		LOGERR("too many runtime files, %s is not moved", path);
+		return path;
+	}
+
+	name = strrchr(path, '/');
+	name = name != NULL ? name + 1 : path;
+	paths[i].full = malloc(strlen(root) + strlen(name) + 2);
+	if (paths[i].full == NULL)
+		return path;
+	sprintf(paths[i].full, "%s/%s", root, name);
+	paths[i].path = path;
+
+	return paths[i].full;
+}
+
 char *get_pkgname(char *exepath)
 {
 	char *filename;
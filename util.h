@@ -36,7 +36,7 @@
  * @param[in] pidpath pid file path
  * @return 0 (always)
  */
-extern int writepid(char *pidpath);
+extern int writepid(const char *pidpath);
 
 /*
  * @brief read the pid
@@ -46,7 +46,7 @@ extern int writepid(char *pidpath);
  * @param[in] pidpath pid file path
  * @return  pid : success, -1 : failed
  */
-extern int readpid(char *pidpath);
+extern int readpid(const char *pidpath);
 
 /*
  * @brief daemonize function 
@@ -76,32 +76,134 @@ extern int exec_process(char *name);
  */
 extern char *get_pkgname(char *exepath);
 
+/*
+ * @brief get the current CLOCK_MONOTONIC time
+ *
+ * @return milliseconds
+ */
+extern long long get_monotonic_ms(void);
+
+/*
+ * @brief get the current CLOCK_BOOTTIME time, the time in suspend included
+ *
+ * @return milliseconds
+ */
+extern long long get_boottime_ms(void);
+
+/*
+ * @brief get the path of a runtime file
+ *
+ * With PM_RUNTIME_ROOT set, the runtime files (sockets, pid file, logs,
+ * state page) are kept in that directory under their own file name,
+ * so several daemons can run side by side.
+ *
+ * @param[in] path default path of the file
+ * @return path to use, valid until the process exits
+ */
+extern const char *runtime_path(const char *path);
+
 /*
  * @brief logging function
  *
- * This is log wrapper
+ * This is log wrapper. Messages are kept in a binary trace ring
+ * and formatted by pm_log_dump(); errors and infos also go to the
+ * system log.
  *
  * @param[in] priority log pritority
- * @param[in] fmt format string
+ * @param[in] fmt format string, it must stay valid (string literal)
  */
 extern void pm_log(int priority, char *fmt, ...);
 
+/*
+ * @brief write the trace ring to fd as text, from the oldest message
+ *
+ * @param[in] fd file descriptor to write
+ */
+extern void pm_log_dump(int fd);
+
+/*
+ * log levels
+ * Statements above PM_LOG_COMPILE_LEVEL are compiled out, the others
+ * are always kept in the trace ring. The runtime level pm_log_level
+ * only decides which ones are also sent to the system log at once, so
+ * the LOGDBG messages of every event cost no formatting by default.
+ */
+#define PM_LOG_LEVEL_ERR	0
+#define PM_LOG_LEVEL_INFO	1
+#define PM_LOG_LEVEL_DEBUG	2
+
+#ifndef PM_LOG_COMPILE_LEVEL
+#  define PM_LOG_COMPILE_LEVEL	PM_LOG_LEVEL_DEBUG
+#endif
+
+/*
+ * a call site logs at most PM_LOG_RATE_BURST messages per interval, its
+ * counters are updated atomically since a site may run on any thread
+ */
+#define PM_LOG_RATE_BURST	10
+#define PM_LOG_RATE_INTERVAL	1000	/* ms */
+
+typedef struct {
+	long long start;
+	unsigned int count;
+	unsigned int missed;
+} pm_log_site;
+
+extern int pm_log_level;
+
+/*
+ * @brief set the runtime log level
+ *
+ * @param[in] level PM_LOG_LEVEL_ERR ~ PM_LOG_LEVEL_DEBUG
+ * @return 0 : success, -EINVAL : invalid level
+ */
+extern int pm_log_set_level(unsigned int level);
+
+/*
+ * @brief per call site rate limiter
+ *
+ * @return 1 : the message can be logged, 0 : suppressed
+ */
+extern int pm_log_ratelimit(pm_log_site *site, int priority, char *fmt);
+
+#define PM_LOG(level, priority, fmt, arg...)				\
+	do {								\
+		if ((level) <= PM_LOG_COMPILE_LEVEL) {			\
+			static pm_log_site _pm_log_site;		\
+			if (pm_log_ratelimit(&_pm_log_site, priority, fmt)) \
+				pm_log(priority, fmt, ## arg);		\
+		}							\
+	} while (0)
+
 #if defined(ENABLE_DLOG_OUT)
 #  include <dlog.h>
+#  define PM_LOG_ERR	DLOG_ERROR
+#  define PM_LOG_INFO	DLOG_INFO
+#  define PM_LOG_DEBUG	DLOG_DEBUG
+#else
+#  include <syslog.h>
+#  define PM_LOG_ERR	LOG_ERR
+#  define PM_LOG_INFO	LOG_INFO
+#  define PM_LOG_DEBUG	LOG_DEBUG
+#endif
+
+/*
+ * @brief LOG_DEBUG wrapper, for the messages of every event
+ */
+#define LOGDBG(fmt, arg...) \
+	PM_LOG(PM_LOG_LEVEL_DEBUG, PM_LOG_DEBUG, fmt, ## arg)
+
 /*
  * @brief LOG_INFO wrapper
  */
-#  define LOGINFO(fmt, arg...) pm_log(DLOG_INFO, fmt, ## arg)
+#define LOGINFO(fmt, arg...) \
+	PM_LOG(PM_LOG_LEVEL_INFO, PM_LOG_INFO, fmt, ## arg)
 
 /*
  * @brief LOG_ERR wrapper
  */
-#  define LOGERR(fmt, arg...) pm_log(DLOG_ERROR, fmt, ## arg)
-#else
-#  include <syslog.h>
-#  define LOGINFO(fmt, arg...) pm_log(LOG_INFO, fmt, ## arg)
-#  define LOGERR(fmt, arg...) pm_log(LOG_ERR, fmt, ## arg)
-#endif
+#define LOGERR(fmt, arg...) \
+	PM_LOG(PM_LOG_LEVEL_ERR, PM_LOG_ERR, fmt, ## arg)
 
 /**
  * @}